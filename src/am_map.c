@@ -18,6 +18,7 @@
 //-----------------------------------------------------------------------------
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "z_zone.h"
 #include "doomdef.h"
@@ -26,6 +27,7 @@
 #include "w_wad.h"
 
 #include "m_cheat.h"
+#include "m_swap.h"
 #include "i_system.h"
 
 // Needs access to LFB.
@@ -142,6 +144,13 @@ typedef struct
 	fixed_t slp, islp;
 } islope_t;
 
+typedef struct
+{
+	mline_t l;
+	const line_t *line;
+	int stamp; // last amstamp it was drawn
+} amline_t;
+
 //
 // The vector graphics for the automap.
 //  A line drawing of the player pointing right,
@@ -275,6 +284,9 @@ static cheatseq_t cheat_amap          = { cheat_amap_seq, 0 };
 
 static boolean stopped = true;
 
+static amline_t *amlines; // level's lines, in map coords
+static int amstamp;       // drawn lines in this frame
+
 extern boolean viewactive;
 //extern byte screens[][SCREENWIDTH*SCREENHEIGHT];
 
@@ -789,12 +801,74 @@ AM_clearFB(int color) {
 	memset(fb, color, f_w * f_h);
 }
 
+static inline int
+AM_round(double v) {
+	return v < 0.0 ? -(int)(0.5 - v) : (int)(v + 0.5);
+}
+
+//
+// Clips a line to the frame buffer, in one pass.
+// Liang-Barsky, both ends are moved along the
+//  line's parameter, so the clipped line keeps
+//  the slope of the original one.
+//
+static boolean
+AM_clipFline(fline_t *fl) {
+	const double dx = fl->b.x - fl->a.x;
+	const double dy = fl->b.y - fl->a.y;
+	const double p[4] = { -dx, dx, -dy, dy };
+	const double q[4] = {
+		fl->a.x,
+		f_w - 1 - fl->a.x,
+		fl->a.y,
+		f_h - 1 - fl->a.y,
+	};
+	double t0 = 0.0;
+	double t1 = 1.0;
+	double t;
+	int i;
+
+	for(i = 0; i < 4; i++) {
+		if(p[i] == 0.0) {
+			// parallel to this edge
+			if(q[i] < 0.0)
+				return false;
+			continue;
+		}
+
+		t = q[i] / p[i];
+		if(p[i] < 0.0) {
+			if(t > t1)
+				return false;
+			if(t > t0)
+				t0 = t;
+		} else {
+			if(t < t0)
+				return false;
+			if(t < t1)
+				t1 = t;
+		}
+	}
+
+	if(t1 < 1.0) {
+		fl->b.x = fl->a.x + AM_round(t1 * dx);
+		fl->b.y = fl->a.y + AM_round(t1 * dy);
+	}
+
+	if(t0 > 0.0) {
+		fl->a.x += AM_round(t0 * dx);
+		fl->a.y += AM_round(t0 * dy);
+	}
+
+	return true;
+}
+
 //
 // Automap clipping of lines.
 //
-// Based on Cohen-Sutherland clipping algorithm but with a slightly
-// faster reject and precalculated slopes.  If the speed is needed,
-// use a hash algorithm to handle  the common cases.
+// Trivial rejects in map coordinates, with the
+// Cohen-Sutherland outcodes, then clipped once
+// in frame buffer coordinates by AM_clipFline.
 //
 boolean
 AM_clipMline(mline_t *ml,
@@ -808,22 +882,6 @@ AM_clipMline(mline_t *ml,
 
 	register int outcode1 = 0;
 	register int outcode2 = 0;
-	register int outside;
-
-	fpoint_t tmp;
-	int dx;
-	int dy;
-
-#define DOOUTCODE(oc, mx, my) \
-	(oc) = 0;                 \
-	if((my) < 0)              \
-		(oc) |= TOP;          \
-	else if((my) >= f_h)      \
-		(oc) |= BOTTOM;       \
-	if((mx) < 0)              \
-		(oc) |= LEFT;         \
-	else if((mx) >= f_w)      \
-		(oc) |= RIGHT;
 
 	// do trivial rejects and outcodes
 	if(ml->a.y > m_y2)
@@ -858,74 +916,26 @@ AM_clipMline(mline_t *ml,
 	fl->b.x = CXMTOF(ml->b.x);
 	fl->b.y = CYMTOF(ml->b.y);
 
-	DOOUTCODE(outcode1, fl->a.x, fl->a.y);
-	DOOUTCODE(outcode2, fl->b.x, fl->b.y);
-
-	if(outcode1 & outcode2)
-		return false;
-
-	while(outcode1 | outcode2) {
-		// may be partially inside box
-		// find an outside point
-		if(outcode1)
-			outside = outcode1;
-		else
-			outside = outcode2;
-
-		// clip to each side
-		if(outside & TOP) {
-			dy    = fl->a.y - fl->b.y;
-			dx    = fl->b.x - fl->a.x;
-			tmp.x = fl->a.x + (dx * (fl->a.y)) / dy;
-			tmp.y = 0;
-		} else if(outside & BOTTOM) {
-			dy    = fl->a.y - fl->b.y;
-			dx    = fl->b.x - fl->a.x;
-			tmp.x = fl->a.x + (dx * (fl->a.y - f_h)) / dy;
-			tmp.y = f_h - 1;
-		} else if(outside & RIGHT) {
-			dy    = fl->b.y - fl->a.y;
-			dx    = fl->b.x - fl->a.x;
-			tmp.y = fl->a.y + (dy * (f_w - 1 - fl->a.x)) / dx;
-			tmp.x = f_w - 1;
-		} else if(outside & LEFT) {
-			dy    = fl->b.y - fl->a.y;
-			dx    = fl->b.x - fl->a.x;
-			tmp.y = fl->a.y + (dy * (-fl->a.x)) / dx;
-			tmp.x = 0;
-		}
-
-		if(outside == outcode1) {
-			fl->a = tmp;
-			DOOUTCODE(outcode1, fl->a.x, fl->a.y);
-		} else {
-			fl->b = tmp;
-			DOOUTCODE(outcode2, fl->b.x, fl->b.y);
-		}
-
-		if(outcode1 & outcode2)
-			return false; // trivially outside
-	}
-
-	return true;
+	return AM_clipFline(fl);
 }
-#undef DOOUTCODE
 
 //
-// Classic Bresenham w/ whatever optimizations needed for speed
+// Line rasterizer for clipped lines.
+// Steps a pointer along the major axis, and by a row
+//  or a pixel whenever the 16.16 minor axis fraction
+//  carries, without any multiply or end test per pixel.
 //
 void
 AM_drawFline(fline_t *fl,
 	int color) {
-	register int x;
-	register int y;
-	register int dx;
-	register int dy;
-	register int sx;
-	register int sy;
-	register int ax;
-	register int ay;
-	register int d;
+	byte *dest;
+	int dx;
+	int dy;
+	int count;
+	int majorstep;
+	int minorstep;
+	fixed_t frac;
+	fixed_t fracstep;
 
 #ifdef RANGECHECK
 	static int fuck = 0;
@@ -940,46 +950,32 @@ AM_drawFline(fline_t *fl,
 	}
 #endif
 
-#define PUTDOT(xx, yy, cc) fb[(yy)*f_w + (xx)] = (cc)
-
-	dx = fl->b.x - fl->a.x;
-	ax = 2 * (dx < 0 ? -dx : dx);
-	sx = dx < 0 ? -1 : 1;
+	dx   = fl->b.x - fl->a.x;
+	dy   = fl->b.y - fl->a.y;
+	dest = fb + fl->a.y * f_w + fl->a.x;
 
-	dy = fl->b.y - fl->a.y;
-	ay = 2 * (dy < 0 ? -dy : dy);
-	sy = dy < 0 ? -1 : 1;
-
-	x = fl->a.x;
-	y = fl->a.y;
-
-	if(ax > ay) {
-		d = ay - ax / 2;
-		while(1) {
-			PUTDOT(x, y, color);
-			if(x == fl->b.x)
-				return;
-			if(d >= 0) {
-				y += sy;
-				d -= ax;
-			}
-			x += sx;
-			d += ay;
-		}
+	if(abs(dx) >= abs(dy)) {
+		count     = abs(dx);
+		majorstep = dx < 0 ? -1 : 1;
+		minorstep = dy < 0 ? -f_w : f_w;
+		fracstep  = count ? (abs(dy) << FRACBITS) / count : 0;
 	} else {
-		d = ax - ay / 2;
-		while(1) {
-			PUTDOT(x, y, color);
-			if(y == fl->b.y)
-				return;
-			if(d >= 0) {
-				x += sx;
-				d -= ay;
-			}
-			y += sy;
-			d += ax;
-		}
+		count     = abs(dy);
+		majorstep = dy < 0 ? -f_w : f_w;
+		minorstep = dx < 0 ? -1 : 1;
+		fracstep  = (abs(dx) << FRACBITS) / count;
 	}
+
+	frac = FRACUNIT / 2;
+	do {
+		*dest = color;
+		dest += majorstep;
+		frac += fracstep;
+		if(frac >= FRACUNIT) {
+			frac -= FRACUNIT;
+			dest += minorstep;
+		}
+	} while(count--);
 }
 
 //
@@ -1036,47 +1032,125 @@ AM_drawGrid(int color) {
 	}
 }
 
+//
+// Caches the geometry of the level's lines,
+//  so the walls are drawn from one contiguous
+//  array instead of through the vertexes.
+//
+static void
+AM_cacheLines(void) {
+	int i;
+
+	Z_Malloc(numlines * sizeof(*amlines), PU_LEVEL, &amlines);
+
+	for(i = 0; i < numlines; i++) {
+		amlines[i].l.a.x = lines[i].v1->x;
+		amlines[i].l.a.y = lines[i].v1->y;
+		amlines[i].l.b.x = lines[i].v2->x;
+		amlines[i].l.b.y = lines[i].v2->y;
+		amlines[i].line  = &lines[i];
+		amlines[i].stamp = 0;
+	}
+
+	amstamp = 0;
+}
+
+//
+// Draws one line, if it is mapped,
+//  with the color of the kind of line it is.
+//
+static void
+AM_drawWall(amline_t *aml) {
+	const line_t *line = aml->line;
+
+	if(aml->stamp == amstamp)
+		return;
+	aml->stamp = amstamp;
+
+	if(cheating || (line->flags & ML_MAPPED)) {
+		if((line->flags & LINE_NEVERSEE) && !cheating)
+			return;
+		if(!line->backsector) {
+			AM_drawMline(&aml->l, WALLCOLORS + lightlev);
+		} else {
+			if(line->special == 39) { // teleporters
+				AM_drawMline(&aml->l, WALLCOLORS + WALLRANGE / 2);
+			} else if(line->flags & ML_SECRET) // secret door
+			{
+				if(cheating)
+					AM_drawMline(&aml->l, SECRETWALLCOLORS + lightlev);
+				else
+					AM_drawMline(&aml->l, WALLCOLORS + lightlev);
+			} else if(line->backsector->floorheight
+					  != line->frontsector->floorheight) {
+				AM_drawMline(&aml->l, FDWALLCOLORS + lightlev); // floor level change
+			} else if(line->backsector->ceilingheight
+					  != line->frontsector->ceilingheight) {
+				AM_drawMline(&aml->l, CDWALLCOLORS + lightlev); // ceiling level change
+			} else if(cheating) {
+				AM_drawMline(&aml->l, TSWALLCOLORS + lightlev);
+			}
+		}
+	} else if(plr->powers[pw_allmap]) {
+		if(!(line->flags & LINE_NEVERSEE))
+			AM_drawMline(&aml->l, GRAYS + 3);
+	}
+}
+
 //
 // Determines visible lines, draws them.
 // This is LineDef based, not LineSeg based.
+// Only the lines of the blockmap cells under
+//  the window are walked, unless the window
+//  covers so many cells that walking all lines
+//  is cheaper.
 //
 void
 AM_drawWalls(void) {
+	const short *list;
+	int bx1, bx2;
+	int by1, by2;
+	int x, y;
 	int i;
-	static mline_t l;
 
-	for(i = 0; i < numlines; i++) {
-		l.a.x = lines[i].v1->x;
-		l.a.y = lines[i].v1->y;
-		l.b.x = lines[i].v2->x;
-		l.b.y = lines[i].v2->y;
-		if(cheating || (lines[i].flags & ML_MAPPED)) {
-			if((lines[i].flags & LINE_NEVERSEE) && !cheating)
-				continue;
-			if(!lines[i].backsector) {
-				AM_drawMline(&l, WALLCOLORS + lightlev);
-			} else {
-				if(lines[i].special == 39) { // teleporters
-					AM_drawMline(&l, WALLCOLORS + WALLRANGE / 2);
-				} else if(lines[i].flags & ML_SECRET) // secret door
-				{
-					if(cheating)
-						AM_drawMline(&l, SECRETWALLCOLORS + lightlev);
-					else
-						AM_drawMline(&l, WALLCOLORS + lightlev);
-				} else if(lines[i].backsector->floorheight
-						  != lines[i].frontsector->floorheight) {
-					AM_drawMline(&l, FDWALLCOLORS + lightlev); // floor level change
-				} else if(lines[i].backsector->ceilingheight
-						  != lines[i].frontsector->ceilingheight) {
-					AM_drawMline(&l, CDWALLCOLORS + lightlev); // ceiling level change
-				} else if(cheating) {
-					AM_drawMline(&l, TSWALLCOLORS + lightlev);
-				}
-			}
-		} else if(plr->powers[pw_allmap]) {
-			if(!(lines[i].flags & LINE_NEVERSEE))
-				AM_drawMline(&l, GRAYS + 3);
+	if(amlines == NULL)
+		AM_cacheLines();
+
+	// stamps wrapped, forget the old ones
+	if(++amstamp == 0) {
+		for(i = 0; i < numlines; i++)
+			amlines[i].stamp = 0;
+		amstamp = 1;
+	}
+
+	bx1 = (m_x - bmaporgx) >> MAPBLOCKSHIFT;
+	bx2 = (m_x2 - bmaporgx) >> MAPBLOCKSHIFT;
+	by1 = (m_y - bmaporgy) >> MAPBLOCKSHIFT;
+	by2 = (m_y2 - bmaporgy) >> MAPBLOCKSHIFT;
+
+	if(bx2 < 0 || by2 < 0 || bx1 >= bmapwidth || by1 >= bmapheight)
+		return;
+
+	if(bx1 < 0)
+		bx1 = 0;
+	if(by1 < 0)
+		by1 = 0;
+	if(bx2 >= bmapwidth)
+		bx2 = bmapwidth - 1;
+	if(by2 >= bmapheight)
+		by2 = bmapheight - 1;
+
+	if((bx2 - bx1 + 1) * (by2 - by1 + 1) * 2 > numlines) {
+		for(i = 0; i < numlines; i++)
+			AM_drawWall(&amlines[i]);
+		return;
+	}
+
+	for(y = by1; y <= by2; y++) {
+		for(x = bx1; x <= bx2; x++) {
+			list = blockmaplump + SHORT(blockmaplump[y * bmapwidth + x + 4]);
+			for(; SHORT(*list) != -1; list++)
+				AM_drawWall(&amlines[SHORT(*list)]);
 		}
 	}
 }
@@ -1188,6 +1262,12 @@ AM_drawThings(int colors,
 	for(i = 0; i < numsectors; i++) {
 		t = sectors[i].thinglist;
 		while(t) {
+			// outside of the window, triangles are 16 units
+			if(t->x < m_x - (16 << FRACBITS) || t->x > m_x2 + (16 << FRACBITS)
+				|| t->y < m_y - (16 << FRACBITS) || t->y > m_y2 + (16 << FRACBITS)) {
+				t = t->snext;
+				continue;
+			}
 			AM_drawLineCharacter(thintriangle_guy, NUMTHINTRIANGLEGUYLINES, 16 << FRACBITS, t->angle, colors + lightlev, t->x, t->y);
 			t = t->snext;
 		}
@@ -94,8 +94,6 @@ boolean singletics = false; // debug flag to cancel adaptiveness
 //extern  int	sfxVolume;
 //extern  int	musicVolume;
 
-extern boolean inhelpscreens;
-
 skill_t startskill;
 int startepisode;
 int startmap;
@@ -167,30 +165,110 @@ D_ProcessEvents(void) {
 
 // wipegamestate can be set to -1 to force a wipe on the next draw
 gamestate_t wipegamestate = GS_DEMOSCREEN;
+
+// Graphics drawn by D_Display, resolved on first use.
+static struct w_handle playpal = W_HANDLE("PLAYPAL");
+static struct w_handle m_pause = W_HANDLE("M_PAUSE");
 extern boolean setsizeneeded;
 extern int showMessages;
 void
 R_ExecuteSetViewSize(void);
 
+//
+// D_DrawOverlay
+// Redraws the HUD, pause pic and menus into the overlay,
+//  composited over screens[0] when presented, only when
+//  any of them changed since the last frame.
+//
+static void
+D_DrawOverlay(boolean hud,
+	boolean pause) {
+	static boolean lasthud;
+	static int lastpausex = -1;
+	static int lastpausey = -1;
+	int pausex;
+	int pausey;
+	boolean changed;
+
+	pausex = -1;
+	pausey = -1;
+	if(pause && paused) {
+		pausex = viewwindowx + (scaledviewwidth - 68) / 2;
+		pausey = automapactive ? 4 : viewwindowy + 4;
+	}
+
+	changed = hud != lasthud || pausex != lastpausex || pausey != lastpausey;
+	if(hud && HU_Changed())
+		changed = true;
+	if(M_Changed())
+		changed = true;
+
+	lasthud    = hud;
+	lastpausex = pausex;
+	lastpausey = pausey;
+
+	if(!changed)
+		return;
+
+	V_BeginOverlay();
+
+	if(hud)
+		HU_Drawer();
+
+	if(pausex >= 0)
+		V_DrawPatchDirect(pausex, pausey, 0, W_LumpForHandle(&m_pause)->data);
+
+	M_Drawer(); // menu is drawn even on top of everything
+	V_EndOverlay();
+}
+
+//
+// D_Wipe
+// Draws one frame of a wipe in progress, when
+//  at least a tic elapsed since the last one.
+// Game tics and network updates keep running
+//  in D_DoomLoop meanwhile.
+//
+static boolean wiping;
+static int wipestart;
+
+static void
+D_Wipe(void) {
+	int nowtime;
+	int tics;
+
+	nowtime = I_GetTime();
+	tics    = nowtime - wipestart;
+	if(!tics)
+		return;
+
+	wipestart = nowtime;
+	wiping    = !wipe_ScreenWipe(wipe_Melt, 0, 0, SCREENWIDTH, SCREENHEIGHT, tics);
+	I_UpdateNoBlit();
+	D_DrawOverlay(false, false); // menu is drawn even on top of wipes
+	I_FinishUpdate();            // page flip or blit buffer
+}
+
 void
 D_Display(void) {
-	static boolean viewactivestate    = false;
-	static boolean menuactivestate    = false;
-	static boolean inhelpscreensstate = false;
-	static boolean fullscreen         = false;
-	static gamestate_t oldgamestate   = -1;
+	static boolean viewactivestate  = false;
+	static boolean fullscreen       = false;
+	static gamestate_t oldgamestate = -1;
 	static int borderdrawcount;
-	int nowtime;
-	int tics;
-	int wipestart;
-	int y;
-	boolean done;
 	boolean wipe;
 	boolean redrawsbar;
 
+	// Nothing allocated during the previous frame is still in use.
+	Z_ScratchRelease(&framescratch, 0);
+
 	if(nodrawers)
 		return; // for comparative timing / profiling
 
+	if(wiping) {
+		D_Wipe();
+		return;
+	}
+
 	redrawsbar = false;
 
 	// change the view size if needed
@@ -207,9 +285,6 @@ D_Display(void) {
 	} else
 		wipe = false;
 
-	if(gamestate == GS_LEVEL && gametic)
-		HU_Erase();
-
 	// do buffered drawing
 	switch(gamestate) {
 	case GS_LEVEL:
@@ -219,8 +294,6 @@ D_Display(void) {
 			AM_Drawer();
 		if(wipe || (viewheight != 200 && fullscreen))
 			redrawsbar = true;
-		if(inhelpscreensstate && !inhelpscreens)
-			redrawsbar = true; // just put away the help screen
 		ST_Drawer(viewheight == 200, redrawsbar);
 		fullscreen = viewheight == 200;
 		break;
@@ -245,12 +318,9 @@ D_Display(void) {
 	if(gamestate == GS_LEVEL && !automapactive && gametic)
 		R_RenderPlayerView(&players[displayplayer]);
 
-	if(gamestate == GS_LEVEL && gametic)
-		HU_Drawer();
-
 	// clean up border stuff
 	if(gamestate != oldgamestate && gamestate != GS_LEVEL)
-		I_SetPalette(W_LumpForName("PLAYPAL")->data);
+		I_SetPalette(W_LumpForHandle(&playpal)->data);
 
 	// see if the border needs to be initially drawn
 	if(gamestate == GS_LEVEL && oldgamestate != GS_LEVEL) {
@@ -260,33 +330,20 @@ D_Display(void) {
 
 	// see if the border needs to be updated to the screen
 	if(gamestate == GS_LEVEL && !automapactive && scaledviewwidth != 320) {
-		if(menuactive || menuactivestate || !viewactivestate)
+		if(!viewactivestate)
 			borderdrawcount = 3;
 		if(borderdrawcount) {
-			R_DrawViewBorder(); // erase old menu stuff
+			R_DrawViewBorder(); // erase old automap
 			borderdrawcount--;
 		}
 	}
 
-	menuactivestate    = menuactive;
-	viewactivestate    = viewactive;
-	inhelpscreensstate = inhelpscreens;
+	viewactivestate = viewactive;
 	oldgamestate = wipegamestate = gamestate;
 
-	// draw pause pic
-	if(paused) {
-		if(automapactive)
-			y = 4;
-		else
-			y = viewwindowy + 4;
-		V_DrawPatchDirect(viewwindowx + (scaledviewwidth - 68) / 2,
-			y,
-			0,
-			W_LumpForName("M_PAUSE")->data);
-	}
-
-	// menus go directly to the screen
-	M_Drawer();  // menu is drawn even on top of everything
+	// HUD, pause pic and menus never touch screens[0],
+	//  so neither erasing nor border redraws are needed
+	D_DrawOverlay(gamestate == GS_LEVEL && gametic, true);
 	NetUpdate(); // send out any new accumulation
 
 	// normal update
@@ -295,22 +352,13 @@ D_Display(void) {
 		return;
 	}
 
-	// wipe update
+	// wipe update, the following frames are
+	//  paced by D_DoomLoop through D_Wipe
 	wipe_EndScreen(0, 0, SCREENWIDTH, SCREENHEIGHT);
 
+	wiping    = true;
 	wipestart = I_GetTime() - 1;
-
-	do {
-		do {
-			nowtime = I_GetTime();
-			tics    = nowtime - wipestart;
-		} while(!tics);
-		wipestart = nowtime;
-		done      = wipe_ScreenWipe(wipe_Melt, 0, 0, SCREENWIDTH, SCREENHEIGHT, tics);
-		I_UpdateNoBlit();
-		M_Drawer();       // menu is drawn even on top of wipes
-		I_FinishUpdate(); // page flip or blit buffer
-	} while(!done);
+	D_Wipe();
 }
 
 //
@@ -390,7 +438,16 @@ D_PageTicker(void) {
 //
 void
 D_PageDrawer(void) {
-	V_DrawPatch(0, 0, 0, W_LumpForName(pagename)->data);
+	static const char *pagelumpname;
+	static const struct w_lump *pagelump;
+
+	// only looked up when it changes
+	if(pagename != pagelumpname) {
+		pagelump     = W_LumpForName(pagename);
+		pagelumpname = pagename;
+	}
+
+	V_DrawPatch(0, 0, 0, pagelump->data);
 }
 
 //
@@ -933,12 +990,18 @@ D_DoomMain(void) {
 	printf("M_LoadDefaults: Load system defaults.\n");
 	M_LoadDefaults(); // load before initing other systems
 
+	if(M_CheckParm("-hugepages"))
+		usehugepages = 1;
+
 	printf("Z_Init: Init zone memory allocation daemon. \n");
 	Z_Init();
 
 	printf("W_Init: Init WADfiles.\n");
 	W_Init((const char **)wadfiles);
 
+	if(usehugepages)
+		I_HugePagesReport();
+
 	// Check for -file in shareware
 	if(modifiedgame) {
 		// These are the lumps that will be checked in IWAD,
@@ -78,6 +78,24 @@ char *t6text = T6TEXT;
 char *finaletext;
 char *finaleflat;
 
+static const char *finaleflatname;
+static const struct w_lump *finaleflatlump;
+
+// Bunny scroll stages.
+static struct w_handle ends[7] = {
+	W_HANDLE("END0"), W_HANDLE("END1"), W_HANDLE("END2"), W_HANDLE("END3"),
+	W_HANDLE("END4"), W_HANDLE("END5"), W_HANDLE("END6")
+};
+
+// Graphics drawn by F_Drawer, resolved on first use.
+static struct w_handle bossback = W_HANDLE("BOSSBACK");
+static struct w_handle pfub2    = W_HANDLE("PFUB2");
+static struct w_handle pfub1    = W_HANDLE("PFUB1");
+static struct w_handle credit   = W_HANDLE("CREDIT");
+static struct w_handle help2    = W_HANDLE("HELP2");
+static struct w_handle victory2 = W_HANDLE("VICTORY2");
+static struct w_handle endpic   = W_HANDLE("ENDPIC");
+
 void
 F_StartCast(void);
 void
@@ -250,8 +268,14 @@ F_TextWrite(void) {
 	int cx;
 	int cy;
 
+	// only looked up when it changes
+	if(finaleflat != finaleflatname) {
+		finaleflatlump = W_LumpForName(finaleflat);
+		finaleflatname = finaleflat;
+	}
+
 	// erase the entire screen to a tiled background
-	src  = W_LumpForName(finaleflat)->data;
+	src  = finaleflatlump->data;
 	dest = screens[0];
 
 	for(y = 0; y < SCREENHEIGHT; y++) {
@@ -571,7 +595,7 @@ F_CastDrawer(void) {
 	const patch_t *patch;
 
 	// erase the entire screen to a background
-	V_DrawPatch(0, 0, 0, W_LumpForName("BOSSBACK")->data);
+	V_DrawPatch(0, 0, 0, W_LumpForHandle(&bossback)->data);
 
 	F_CastPrint(castorder[castnum].name);
 
@@ -581,7 +605,7 @@ F_CastDrawer(void) {
 	lump     = sprframe->lump[0];
 	flip     = (boolean)sprframe->flip[0];
 
-	patch = W_LumpForId(lump + firstspritelump)->data;
+	patch = W_LumpForId(spritelumps[lump])->data;
 	if(flip)
 		V_DrawPatchFlipped(160, 170, 0, patch);
 	else
@@ -627,12 +651,11 @@ F_BunnyScroll(void) {
 	int x;
 	const patch_t *p1;
 	const patch_t *p2;
-	char name[10];
 	int stage;
 	static int laststage;
 
-	p1 = W_LumpForName("PFUB2")->data;
-	p2 = W_LumpForName("PFUB1")->data;
+	p1 = W_LumpForHandle(&pfub2)->data;
+	p2 = W_LumpForHandle(&pfub1)->data;
 
 	V_MarkRect(0, 0, SCREENWIDTH, SCREENHEIGHT);
 
@@ -655,7 +678,7 @@ F_BunnyScroll(void) {
 		V_DrawPatch((SCREENWIDTH - 13 * 8) / 2,
 			(SCREENHEIGHT - 8 * 8) / 2,
 			0,
-			W_LumpForName("END0")->data);
+			W_LumpForHandle(&ends[0])->data);
 		laststage = 0;
 		return;
 	}
@@ -668,8 +691,7 @@ F_BunnyScroll(void) {
 		laststage = stage;
 	}
 
-	sprintf(name, "END%i", stage);
-	V_DrawPatch((SCREENWIDTH - 13 * 8) / 2, (SCREENHEIGHT - 8 * 8) / 2, 0, W_LumpForName(name)->data);
+	V_DrawPatch((SCREENWIDTH - 13 * 8) / 2, (SCREENHEIGHT - 8 * 8) / 2, 0, W_LumpForHandle(&ends[stage])->data);
 }
 
 //
@@ -688,18 +710,18 @@ F_Drawer(void) {
 		switch(gameepisode) {
 		case 1:
 			if(gamemode == retail)
-				V_DrawPatch(0, 0, 0, W_LumpForName("CREDIT")->data);
+				V_DrawPatch(0, 0, 0, W_LumpForHandle(&credit)->data);
 			else
-				V_DrawPatch(0, 0, 0, W_LumpForName("HELP2")->data);
+				V_DrawPatch(0, 0, 0, W_LumpForHandle(&help2)->data);
 			break;
 		case 2:
-			V_DrawPatch(0, 0, 0, W_LumpForName("VICTORY2")->data);
+			V_DrawPatch(0, 0, 0, W_LumpForHandle(&victory2)->data);
 			break;
 		case 3:
 			F_BunnyScroll();
 			break;
 		case 4:
-			V_DrawPatch(0, 0, 0, W_LumpForName("ENDPIC")->data);
+			V_DrawPatch(0, 0, 0, W_LumpForHandle(&endpic)->data);
 			break;
 		}
 	}
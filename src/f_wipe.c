@@ -37,23 +37,22 @@ static byte *wipe_scr_start;
 static byte *wipe_scr_end;
 static byte *wipe_scr;
 
-void
-wipe_shittyColMajorXform(short *array,
+// Column-major copies of the start and end screens,
+//  in pairs of pixels, allocated by the first melt.
+static short *wipe_colstart;
+static short *wipe_colend;
+
+static void
+wipe_colMajorXform(short *dest,
+	const short *array,
 	int width,
 	int height) {
 	int x;
 	int y;
-	short *dest;
 
-	dest = (short *)Z_Malloc(width * height * 2, PU_STATIC, 0);
-
-	for(y = 0; y < height; y++)
-		for(x = 0; x < width; x++)
+	for(x = 0; x < width; x++)
+		for(y = 0; y < height; y++)
 			dest[x * height + y] = array[y * width + x];
-
-	memcpy(array, dest, width * height * 2);
-
-	Z_Free(dest);
 }
 
 int
@@ -64,39 +63,27 @@ wipe_initColorXForm(int width,
 	return 0;
 }
 
+//
+// Fades each pixel index towards the end screen's one.
+// Branchless, so it is vectorizable when optimizing.
+//
 int
 wipe_doColorXForm(int width,
 	int height,
 	int ticks) {
-	boolean changed;
-	byte *w;
-	byte *e;
-	int newval;
-
-	changed = false;
-	w       = wipe_scr;
-	e       = wipe_scr_end;
-
-	while(w != wipe_scr + width * height) {
-		if(*w != *e) {
-			if(*w > *e) {
-				newval = *w - ticks;
-				if(newval < *e)
-					*w = *e;
-				else
-					*w = newval;
-				changed = true;
-			} else if(*w < *e) {
-				newval = *w + ticks;
-				if(newval > *e)
-					*w = *e;
-				else
-					*w = newval;
-				changed = true;
-			}
-		}
-		w++;
-		e++;
+	const int size = width * height;
+	int changed;
+	int i;
+
+	changed = 0;
+	for(i = 0; i < size; i++) {
+		const int w    = wipe_scr[i];
+		const int e    = wipe_scr_end[i];
+		const int up   = w + ticks;
+		const int down = w - ticks;
+
+		changed |= w != e;
+		wipe_scr[i] = w < e ? (up < e ? up : e) : (down > e ? down : e);
 	}
 
 	return !changed;
@@ -109,7 +96,8 @@ wipe_exitColorXForm(int width,
 	return 0;
 }
 
-static int *y;
+// Column positions, y<0 => not ready to scroll yet.
+static int y[SCREENWIDTH];
 
 int
 wipe_initMelt(int width,
@@ -122,12 +110,15 @@ wipe_initMelt(int width,
 
 	// makes this wipe faster (in theory)
 	// to have stuff in column-major format
-	wipe_shittyColMajorXform((short *)wipe_scr_start, width / 2, height);
-	wipe_shittyColMajorXform((short *)wipe_scr_end, width / 2, height);
+	if(wipe_colstart == NULL) {
+		wipe_colstart = Z_Malloc(width * height, PU_STATIC, 0);
+		wipe_colend   = Z_Malloc(width * height, PU_STATIC, 0);
+	}
+	wipe_colMajorXform(wipe_colstart, (short *)wipe_scr_start, width / 2, height);
+	wipe_colMajorXform(wipe_colend, (short *)wipe_scr_end, width / 2, height);
 
 	// setup initial column positions
 	// (y<0 => not ready to scroll yet)
-	y    = (int *)Z_Malloc(width * sizeof(int), PU_STATIC, 0);
 	y[0] = -(M_Random() % 16);
 	for(i = 1; i < width; i++) {
 		r    = (M_Random() % 3) - 1;
@@ -141,48 +132,66 @@ wipe_initMelt(int width,
 	return 0;
 }
 
+//
+// Moves the columns by all the elapsed tics first,
+//  then only writes what they uncovered since the
+//  last call, once.
+//
 int
 wipe_doMelt(int width,
 	int height,
 	int ticks) {
 	int i;
 	int j;
+	int t;
 	int dy;
+	int top;
 	int idx;
 
-	short *s;
+	const short *s;
 	short *d;
 	boolean done = true;
 
 	width /= 2;
 
-	while(ticks--) {
-		for(i = 0; i < width; i++) {
+	for(i = 0; i < width; i++) {
+		if(y[i] >= height)
+			continue;
+
+		done = false;
+		top  = y[i] < 0 ? 0 : y[i];
+
+		for(t = ticks; t && y[i] < height; t--) {
 			if(y[i] < 0) {
 				y[i]++;
-				done = false;
-			} else if(y[i] < height) {
+			} else {
 				dy = (y[i] < 16) ? y[i] + 1 : 8;
 				if(y[i] + dy >= height)
 					dy = height - y[i];
-				s   = &((short *)wipe_scr_end)[i * height + y[i]];
-				d   = &((short *)wipe_scr)[y[i] * width + i];
-				idx = 0;
-				for(j = dy; j; j--) {
-					d[idx] = *(s++);
-					idx += width;
-				}
 				y[i] += dy;
-				s   = &((short *)wipe_scr_start)[i * height];
-				d   = &((short *)wipe_scr)[y[i] * width + i];
-				idx = 0;
-				for(j = height - y[i]; j; j--) {
-					d[idx] = *(s++);
-					idx += width;
-				}
-				done = false;
 			}
 		}
+
+		if(y[i] <= 0)
+			continue;
+
+		// end screen uncovered
+		s   = &wipe_colend[i * height + top];
+		d   = &((short *)wipe_scr)[top * width + i];
+		idx = 0;
+		for(j = y[i] - top; j; j--) {
+			d[idx] = *(s++);
+			idx += width;
+		}
+
+		// start screen moved down
+		s   = &wipe_colstart[i * height];
+		d   = &((short *)wipe_scr)[y[i] * width + i];
+		idx = 0;
+		for(j = height - y[i]; j; j--) {
+			d[idx] = *(s++);
+			idx += width;
+		}
 	}
 
 	return done;
@@ -192,7 +201,6 @@ int
 wipe_exitMelt(int width,
 	int height,
 	int ticks) {
-	Z_Free(y);
 	return 0;
 }
 
@@ -1536,6 +1536,8 @@ G_CheckDemoStatus(void) {
 
 	if(timingdemo) {
 		endtime = I_GetTime();
+		R_PrintStats();
+		Z_PrintStats();
 		I_Error("timed %i gametics in %i realtics", gametic, endtime - starttime);
 	}
 
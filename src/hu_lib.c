@@ -25,12 +25,6 @@
 
 #include "hu_lib.h"
 #include "r_local.h"
-#include "r_draw.h"
-
-// boolean : whether the screen is always erased
-#define noterased viewwindowx
-
-extern boolean automapactive; // in AM_map.c
 
 void
 HUlib_init(void) {
@@ -65,7 +59,7 @@ HUlib_addCharToTextLine(hu_textline_t *t,
 	else {
 		t->l[t->len++] = ch;
 		t->l[t->len]   = 0;
-		t->needsupdate = 4;
+		t->needsupdate = true;
 		return true;
 	}
 }
@@ -77,7 +71,7 @@ HUlib_delCharFromTextLine(hu_textline_t *t) {
 		return false;
 	else {
 		t->l[--t->len] = 0;
-		t->needsupdate = 4;
+		t->needsupdate = true;
 		return true;
 	}
 }
@@ -117,34 +111,13 @@ HUlib_drawTextLine(hu_textline_t *l,
 	}
 }
 
-// sorta called by HU_Erase and just better darn get things straight
-void
-HUlib_eraseTextLine(hu_textline_t *l) {
-	int lh;
-	int y;
-	int yoffset;
-	static boolean lastautomapactive = true;
-
-	// Only erases when NOT in automap and the screen is reduced,
-	// and the text must either need updating or refreshing
-	// (because of a recent change back from the automap)
-
-	if(!automapactive && viewwindowx && l->needsupdate) {
-		lh = SHORT(l->f[0]->height) + 1;
-		for(y = l->y, yoffset = y * SCREENWIDTH; y < l->y + lh; y++, yoffset += SCREENWIDTH) {
-			if(y < viewwindowy || y >= viewwindowy + viewheight)
-				R_VideoErase(yoffset, SCREENWIDTH); // erase entire line
-			else {
-				R_VideoErase(yoffset, viewwindowx); // erase left border
-				R_VideoErase(yoffset + viewwindowx + viewwidth, viewwindowx);
-				// erase right border
-			}
-		}
-	}
+boolean
+HUlib_changedTextLine(hu_textline_t *l) {
+	boolean changed;
 
-	lastautomapactive = automapactive;
-	if(l->needsupdate)
-		l->needsupdate--;
+	changed        = l->needsupdate;
+	l->needsupdate = false;
+	return changed;
 }
 
 void
@@ -182,7 +155,7 @@ HUlib_addLineToSText(hu_stext_t *s) {
 
 	// everything needs updating
 	for(i = 0; i < s->h; i++)
-		s->l[i].needsupdate = 4;
+		s->l[i].needsupdate = true;
 }
 
 void
@@ -219,17 +192,17 @@ HUlib_drawSText(hu_stext_t *s) {
 	}
 }
 
-void
-HUlib_eraseSText(hu_stext_t *s) {
-
+boolean
+HUlib_changedSText(hu_stext_t *s) {
+	boolean changed;
 	int i;
 
-	for(i = 0; i < s->h; i++) {
-		if(s->laston && !*s->on)
-			s->l[i].needsupdate = 4;
-		HUlib_eraseTextLine(&s->l[i]);
-	}
+	changed = s->laston != *s->on;
+	for(i = 0; i < s->h; i++)
+		changed |= HUlib_changedTextLine(&s->l[i]);
 	s->laston = *s->on;
+
+	return changed;
 }
 
 void
@@ -299,10 +272,13 @@ HUlib_drawIText(hu_itext_t *it) {
 	HUlib_drawTextLine(l, true); // draw the line w/ cursor
 }
 
-void
-HUlib_eraseIText(hu_itext_t *it) {
-	if(it->laston && !*it->on)
-		it->l.needsupdate = 4;
-	HUlib_eraseTextLine(&it->l);
+boolean
+HUlib_changedIText(hu_itext_t *it) {
+	boolean changed;
+
+	changed    = it->laston != *it->on;
+	changed   |= HUlib_changedTextLine(&it->l);
 	it->laston = *it->on;
+
+	return changed;
 }
@@ -48,8 +48,8 @@ typedef struct
 	char l[HU_MAXLINELENGTH + 1]; // line of text
 	int len;                      // current line length
 
-	// whether this line needs to be udpated
-	int needsupdate;
+	// whether this line changed since last drawn
+	boolean needsupdate;
 
 } hu_textline_t;
 
@@ -113,9 +113,9 @@ HUlib_delCharFromTextLine(hu_textline_t *t);
 void
 HUlib_drawTextLine(hu_textline_t *l, boolean drawcursor);
 
-// erases text line
-void
-HUlib_eraseTextLine(hu_textline_t *l);
+// whether tline changed since last asked
+boolean
+HUlib_changedTextLine(hu_textline_t *l);
 
 //
 // Scrolling Text window widget routines
@@ -145,9 +145,9 @@ HUlib_addMessageToSText(hu_stext_t *s,
 void
 HUlib_drawSText(hu_stext_t *s);
 
-// erases all stext lines
-void
-HUlib_eraseSText(hu_stext_t *s);
+// whether stext changed since last asked
+boolean
+HUlib_changedSText(hu_stext_t *s);
 
 // Input Text Line widget routines
 void
@@ -183,8 +183,8 @@ HUlib_keyInIText(hu_itext_t *it,
 void
 HUlib_drawIText(hu_itext_t *it);
 
-// erases all itext lines
-void
-HUlib_eraseIText(hu_itext_t *it);
+// whether itext changed since last asked
+boolean
+HUlib_changedIText(hu_itext_t *it);
 
 #endif
@@ -775,12 +775,19 @@ HU_Drawer(void) {
 		HUlib_drawTextLine(&w_title, false);
 }
 
-void
-HU_Erase(void) {
+boolean
+HU_Changed(void) {
+	static boolean lastautomapactive = false;
+	boolean changed;
+
+	changed  = HUlib_changedSText(&w_message);
+	changed |= HUlib_changedIText(&w_chat);
+	changed |= HUlib_changedTextLine(&w_title);
+	changed |= automapactive != lastautomapactive;
+
+	lastautomapactive = automapactive;
 
-	HUlib_eraseSText(&w_message);
-	HUlib_eraseIText(&w_chat);
-	HUlib_eraseTextLine(&w_title);
+	return changed;
 }
 
 void
@@ -56,7 +56,10 @@ void
 HU_Drawer(void);
 char
 HU_dequeueChatChar(void);
-void
-HU_Erase(void);
+
+// Whether HU_Drawer would draw anything
+// different since last asked.
+boolean
+HU_Changed(void);
 
 #endif
@@ -41,7 +41,23 @@
 
 #define POINTER_WARP_COUNTDOWN 5
 
+// Transparent huge pages only back aligned 2MB ranges.
+#define HUGEPAGESIZE (2 * 1024 * 1024)
+#define HUGEPAGEROUND(size) (((size) + HUGEPAGESIZE - 1) & ~(size_t)(HUGEPAGESIZE - 1))
+
+#define MAXHUGEMAPPINGS 16
+
 int mb_used = 6;
+int usehugepages = 0;
+
+// Startup mappings backed by I_MapHuge, for I_HugePagesReport.
+static struct i_hugeMapping {
+	char name[32];
+	const void *address;
+	size_t size;
+	boolean hugetlb;
+} i_hugemappings[MAXHUGEMAPPINGS];
+static int i_hugemappingscount;
 
 void
 I_Init(void) {
@@ -49,14 +65,141 @@ I_Init(void) {
 	I_InitXCB();
 }
 
+//
+// I_MapHuge
+// Anonymous memory, from the hugetlb pool when it has room,
+//  else 2MB aligned and advised for transparent huge pages.
+// Pages are faulted in so they are backed right away.
+//
+static void *
+I_MapHuge(const char *name,
+	size_t size) {
+	struct i_hugeMapping *mapping;
+	boolean hugetlb;
+	uintptr_t begin;
+	uintptr_t end;
+	byte *address;
+
+	hugetlb = true;
+	address = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+	if(address == MAP_FAILED) {
+		hugetlb = false;
+		address = mmap(NULL, size + HUGEPAGESIZE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(address == MAP_FAILED)
+			return NULL;
+
+		// trim the misaligned head and tail
+		begin = HUGEPAGEROUND((uintptr_t)address);
+		end   = (uintptr_t)address + size + HUGEPAGESIZE;
+		if(begin != (uintptr_t)address)
+			munmap(address, begin - (uintptr_t)address);
+		if(end != begin + size)
+			munmap((void *)(begin + size), end - begin - size);
+		address = (byte *)begin;
+
+		madvise(address, size, MADV_HUGEPAGE);
+	}
+
+	memset(address, 0, size);
+
+	if(name != NULL && i_hugemappingscount < MAXHUGEMAPPINGS) {
+		mapping = &i_hugemappings[i_hugemappingscount++];
+		snprintf(mapping->name, sizeof(mapping->name), "%s", name);
+		mapping->address = address;
+		mapping->size    = size;
+		mapping->hugetlb = hugetlb;
+	}
+
+	return address;
+}
+
 byte *
 I_ZoneBase(int *size) {
+	byte *base;
 
 	*size = mb_used * 1024 * 1024;
 
+	if(usehugepages) {
+		*size = HUGEPAGEROUND(*size);
+		base  = I_MapHuge("zone", *size);
+		if(base != NULL)
+			return base;
+	}
+
 	return malloc(*size);
 }
 
+byte *
+I_ZoneGrow(int size) {
+	void *segment;
+
+	// segments are whole huge pages already
+	if(usehugepages)
+		return I_MapHuge(NULL, size);
+
+	segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(segment == MAP_FAILED)
+		return NULL;
+
+	return segment;
+}
+
+//
+// I_HugePagesReport
+// Reads back how much of each startup mapping
+//  the kernel really backed with huge pages.
+//
+void
+I_HugePagesReport(void) {
+	const struct i_hugeMapping *mapping;
+	char line[256];
+	unsigned long begin;
+	unsigned long end;
+	FILE *smaps;
+	long huge;
+	long kb;
+	int i;
+
+	printf("I_HugePagesReport: huge page backing\n");
+
+	for(i = 0; i < i_hugemappingscount; i++) {
+		mapping = &i_hugemappings[i];
+		smaps   = fopen("/proc/self/smaps", "r");
+		huge    = -1;
+
+		if(smaps != NULL) {
+			while(fgets(line, sizeof(line), smaps) != NULL) {
+				if(sscanf(line, "%lx-%lx ", &begin, &end) == 2) {
+					if(huge >= 0)
+						break;
+					if((unsigned long)mapping->address >= begin && (unsigned long)mapping->address < end)
+						huge = 0;
+				} else if(huge >= 0
+					&& (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1
+						|| sscanf(line, "Private_Hugetlb: %ld kB", &kb) == 1)) {
+					huge += kb;
+				}
+			}
+			fclose(smaps);
+		}
+
+		if(huge < 0)
+			printf("\t%-12s %6zu kB, unknown\n", mapping->name, mapping->size / 1024);
+		else
+			printf("\t%-12s %6zu kB, %6ld kB in %s huge pages\n", mapping->name,
+				mapping->size / 1024, huge, mapping->hugetlb ? "hugetlb" : "transparent");
+	}
+}
+
+void
+I_ZoneRelease(byte *segment,
+	int size) {
+	munmap(segment, size);
+}
+
 int
 I_GetTime(void) {
 	struct timespec now;
@@ -66,6 +209,22 @@ I_GetTime(void) {
 	return now.tv_sec * TICRATE + now.tv_nsec * TICRATE / 1000000000;
 }
 
+uint64_t
+I_GetTimeUS(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+int
+I_GetCPUCount(void) {
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return count > 0 ? count : 1;
+}
+
 void
 I_StartFrame(void) {
 }
@@ -142,31 +301,77 @@ I_Error(char *error, ...) {
 	exit(EXIT_FAILURE);
 }
 
-void
-I_FileMap(const char *filename, struct i_fileMap *filemap) {
+boolean
+I_FileTryMap(const char *filename, struct i_fileMap *filemap) {
 	const int fd = open(filename, O_RDONLY);
 	struct stat st;
 
 	if(fd < 0) {
-		I_Error("I_FileMap: Unable to open %s: %s", filename, strerror(errno));
+		return false;
 	}
 
 	if(fstat(fd, &st) != 0) {
-		I_Error("I_FileMap: Unable to stat %s: %s", filename, strerror(errno));
+		close(fd);
+		return false;
 	}
 
 	filemap->size = st.st_size;
+	filemap->length = filemap->size;
 	filemap->address = mmap(0, filemap->size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-	if(filemap->address == MAP_FAILED) {
+	close(fd);
+
+	return filemap->address != MAP_FAILED;
+}
+
+void
+I_FileMap(const char *filename, struct i_fileMap *filemap) {
+
+	if(!I_FileTryMap(filename, filemap)) {
 		I_Error("I_FileMap: Unable to map %s: %s", filename, strerror(errno));
 	}
 
-	close(fd);
+	if(usehugepages && filemap->size != 0) {
+		// Lumps are sampled all over the place while rendering,
+		// trade the lazy file mapping for a huge page backed copy.
+		const char *basename = strrchr(filename, '/');
+		void *copy;
+
+		copy = I_MapHuge(basename != NULL ? basename + 1 : filename, HUGEPAGEROUND(filemap->size));
+		if(copy != NULL) {
+			memcpy(copy, filemap->address, filemap->size);
+			munmap(filemap->address, filemap->size);
+			mprotect(copy, HUGEPAGEROUND(filemap->size), PROT_READ);
+			filemap->address = copy;
+			filemap->length = HUGEPAGEROUND(filemap->size);
+		}
+	}
 }
 
 void
 I_FileUnMap(struct i_fileMap *filemap) {
-	munmap(filemap->address, filemap->size);
+	munmap(filemap->address, filemap->length);
 }
 
+void
+I_FileAdvise(const void *address, size_t size) {
+	const uintptr_t pagemask = sysconf(_SC_PAGESIZE) - 1;
+	const uintptr_t begin = (uintptr_t)address & ~pagemask;
+
+	if(size != 0) {
+		madvise((void *)begin, (uintptr_t)address + size - begin, MADV_WILLNEED);
+	}
+}
+
+void
+I_FileTouch(const void *address, size_t size) {
+	const uintptr_t pagesize = sysconf(_SC_PAGESIZE);
+	const uintptr_t end = (uintptr_t)address + size;
+	volatile const uint8_t *page = (const uint8_t *)((uintptr_t)address & ~(pagesize - 1));
+
+	if(size != 0) {
+		for(; (uintptr_t)page < end; page += pagesize) {
+			(void)*page;
+		}
+	}
+}
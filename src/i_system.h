@@ -26,8 +26,13 @@
 struct i_fileMap {
 	void *address;
 	size_t size;
+	size_t length; // of the mapping
 };
 
+// Back the zone and WAD files with huge pages,
+// from the configuration or -hugepages.
+extern int usehugepages;
+
 // Called by DoomMain.
 void
 I_Init(void);
@@ -38,11 +43,34 @@ I_Init(void);
 byte *
 I_ZoneBase(int *size);
 
+// Called by D_DoomMain after W_Init when usehugepages is set,
+// prints which mappings actually got huge pages.
+void
+I_HugePagesReport(void);
+
+// Called by Z_Malloc when the zone is full,
+// maps size more bytes, NULL if impossible.
+byte *
+I_ZoneGrow(int size);
+
+// Called by Z_FreeTags, unmaps an emptied segment.
+void
+I_ZoneRelease(byte *segment, int size);
+
 // Called by D_DoomLoop,
 // returns current time in tics.
 int
 I_GetTime(void);
 
+// Monotonic wall clock in microseconds,
+// for frame timings.
+uint64_t
+I_GetTimeUS(void);
+
+// Online processors, to size worker pools.
+int
+I_GetCPUCount(void);
+
 //
 // Called by D_DoomLoop,
 // called before processing any tics in a frame
@@ -92,7 +120,21 @@ I_Error(char *error, ...);
 void
 I_FileMap(const char *filename, struct i_fileMap *filemap);
 
+// Same as I_FileMap, but returns false on failure,
+// for files which may be missing.
+boolean
+I_FileTryMap(const char *filename, struct i_fileMap *filemap);
+
 void
 I_FileUnMap(struct i_fileMap *filemap);
 
+// Starts reading in the pages of a mapped range.
+void
+I_FileAdvise(const void *address, size_t size);
+
+// Faults in the pages of a mapped range,
+// blocks until they are resident.
+void
+I_FileTouch(const void *address, size_t size);
+
 #endif
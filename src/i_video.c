@@ -117,9 +117,33 @@ I_FinishUpdate(void) {
 
 	const uint8_t * const framebufferend = framebuffer + i_xcb.framebuffer.width * i_xcb.framebuffer.height;
 	const size_t scanline_padding = i_video.framebuffer_stride - i_xcb.framebuffer.width * i_video.format_bytes_per_pixel;
+
+	/* Rows covered by the overlay are composited while converting */
+	const uint8_t * const overlaystart = screens[0] + overlaytop * SCREENWIDTH;
+	const uint8_t * const overlayend = screens[0] + overlaybottom * SCREENWIDTH;
 	while(framebuffer != framebufferend) {
 		const uint8_t * const framebufferrowend = framebuffer + i_xcb.framebuffer.width;
 
+		if(framebuffer >= overlaystart && framebuffer < overlayend) {
+			const uint8_t *source = overlay + (framebuffer - screens[0]);
+			const uint8_t *mask = overlaymask + (framebuffer - screens[0]);
+
+			while(framebuffer != framebufferrowend) {
+				const uint8_t pixel = (*framebuffer & ~*mask) | (*source & *mask);
+				const uint8_t * const rgb_pixel = i_video.colormap + pixel * i_video.format_bytes_per_pixel;
+
+				__builtin_memcpy(scanline, rgb_pixel, i_video.format_bytes_per_pixel);
+
+				scanline += i_video.format_bytes_per_pixel;
+				framebuffer++;
+				source++;
+				mask++;
+			}
+
+			scanline += scanline_padding;
+			continue;
+		}
+
 		while(framebuffer != framebufferrowend) {
 			const uint8_t * const rgb_pixel = i_video.colormap + *framebuffer * i_video.format_bytes_per_pixel;
 
@@ -164,6 +188,7 @@ I_WaitVBL(int count) {
 void
 I_ReadScreen(uint8_t *scr) {
 	memcpy(scr, screens[0], SCREENWIDTH*SCREENHEIGHT);
+	V_ComposeOverlay(scr);
 }
 
 void
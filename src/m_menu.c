@@ -137,6 +137,9 @@ typedef struct
 
 	// hotkey in menu
 	char alphaKey;
+
+	// graphic of name, once drawn
+	const struct w_lump *lump;
 } menuitem_t;
 
 typedef struct menu_s {
@@ -153,9 +156,35 @@ short itemOn;           // menu item skull is on
 short skullAnimCounter; // skull animation counter
 short whichSkull;       // which skull to draw
 
-// graphic name of skulls
-// warning: initializer-string for array of chars is too long
-char skullName[2][/*8*/ 9] = { "M_SKULL1", "M_SKULL2" };
+// whether an event changed the menus since M_Changed
+static boolean menuchanged;
+
+// graphics of skulls
+static struct w_handle skulls[2] = { W_HANDLE("M_SKULL1"), W_HANDLE("M_SKULL2") };
+
+// Graphics drawn by the menus, resolved on first use.
+static struct w_handle m_loadg  = W_HANDLE("M_LOADG");
+static struct w_handle m_lsleft = W_HANDLE("M_LSLEFT");
+static struct w_handle m_lscntr = W_HANDLE("M_LSCNTR");
+static struct w_handle m_lsrght = W_HANDLE("M_LSRGHT");
+static struct w_handle m_saveg  = W_HANDLE("M_SAVEG");
+static struct w_handle help     = W_HANDLE("HELP");
+static struct w_handle help1    = W_HANDLE("HELP1");
+static struct w_handle credit   = W_HANDLE("CREDIT");
+static struct w_handle help2    = W_HANDLE("HELP2");
+static struct w_handle m_svol   = W_HANDLE("M_SVOL");
+static struct w_handle m_doom   = W_HANDLE("M_DOOM");
+static struct w_handle m_newg   = W_HANDLE("M_NEWG");
+static struct w_handle m_skill  = W_HANDLE("M_SKILL");
+static struct w_handle m_episod = W_HANDLE("M_EPISOD");
+static struct w_handle m_optttl = W_HANDLE("M_OPTTTL");
+static struct w_handle m_therml = W_HANDLE("M_THERML");
+static struct w_handle m_thermm = W_HANDLE("M_THERMM");
+static struct w_handle m_thermr = W_HANDLE("M_THERMR");
+static struct w_handle m_thermo = W_HANDLE("M_THERMO");
+static struct w_handle m_cell1  = W_HANDLE("M_CELL1");
+static struct w_handle m_cell2  = W_HANDLE("M_CELL2");
+static struct w_handle playpal  = W_HANDLE("PLAYPAL");
 
 // current menudef
 menu_t *currentMenu;
@@ -544,7 +573,7 @@ void
 M_DrawLoad(void) {
 	int i;
 
-	V_DrawPatchDirect(72, 28, 0, W_LumpForName("M_LOADG")->data);
+	V_DrawPatchDirect(72, 28, 0, W_LumpForHandle(&m_loadg)->data);
 	for(i = 0; i < load_end; i++) {
 		M_DrawSaveLoadBorder(LoadDef.x, LoadDef.y + LINEHEIGHT * i);
 		M_WriteText(LoadDef.x, LoadDef.y + LINEHEIGHT * i, savegamestrings[i]);
@@ -558,14 +587,14 @@ void
 M_DrawSaveLoadBorder(int x, int y) {
 	int i;
 
-	V_DrawPatchDirect(x - 8, y + 7, 0, W_LumpForName("M_LSLEFT")->data);
+	V_DrawPatchDirect(x - 8, y + 7, 0, W_LumpForHandle(&m_lsleft)->data);
 
 	for(i = 0; i < 24; i++) {
-		V_DrawPatchDirect(x, y + 7, 0, W_LumpForName("M_LSCNTR")->data);
+		V_DrawPatchDirect(x, y + 7, 0, W_LumpForHandle(&m_lscntr)->data);
 		x += 8;
 	}
 
-	V_DrawPatchDirect(x, y + 7, 0, W_LumpForName("M_LSRGHT")->data);
+	V_DrawPatchDirect(x, y + 7, 0, W_LumpForHandle(&m_lsrght)->data);
 }
 
 //
@@ -604,7 +633,7 @@ void
 M_DrawSave(void) {
 	int i;
 
-	V_DrawPatchDirect(72, 28, 0, W_LumpForName("M_SAVEG")->data);
+	V_DrawPatchDirect(72, 28, 0, W_LumpForHandle(&m_saveg)->data);
 	for(i = 0; i < load_end; i++) {
 		M_DrawSaveLoadBorder(LoadDef.x, LoadDef.y + LINEHEIGHT * i);
 		M_WriteText(LoadDef.x, LoadDef.y + LINEHEIGHT * i, savegamestrings[i]);
@@ -730,12 +759,12 @@ M_DrawReadThis1(void) {
 	inhelpscreens = true;
 	switch(gamemode) {
 	case commercial:
-		V_DrawPatchDirect(0, 0, 0, W_LumpForName("HELP")->data);
+		V_DrawPatchDirect(0, 0, 0, W_LumpForHandle(&help)->data);
 		break;
 	case shareware:
 	case registered:
 	case retail:
-		V_DrawPatchDirect(0, 0, 0, W_LumpForName("HELP1")->data);
+		V_DrawPatchDirect(0, 0, 0, W_LumpForHandle(&help1)->data);
 		break;
 	default:
 		break;
@@ -753,11 +782,11 @@ M_DrawReadThis2(void) {
 	case retail:
 	case commercial:
 		// This hack keeps us from having to change menus.
-		V_DrawPatchDirect(0, 0, 0, W_LumpForName("CREDIT")->data);
+		V_DrawPatchDirect(0, 0, 0, W_LumpForHandle(&credit)->data);
 		break;
 	case shareware:
 	case registered:
-		V_DrawPatchDirect(0, 0, 0, W_LumpForName("HELP2")->data);
+		V_DrawPatchDirect(0, 0, 0, W_LumpForHandle(&help2)->data);
 		break;
 	default:
 		break;
@@ -770,7 +799,7 @@ M_DrawReadThis2(void) {
 //
 void
 M_DrawSound(void) {
-	V_DrawPatchDirect(60, 38, 0, W_LumpForName("M_SVOL")->data);
+	V_DrawPatchDirect(60, 38, 0, W_LumpForHandle(&m_svol)->data);
 
 	M_DrawThermo(SoundDef.x, SoundDef.y + LINEHEIGHT * (sfx_vol + 1), 16, snd_SfxVolume);
 
@@ -819,7 +848,7 @@ M_MusicVol(int choice) {
 //
 void
 M_DrawMainMenu(void) {
-	V_DrawPatchDirect(94, 2, 0, W_LumpForName("M_DOOM")->data);
+	V_DrawPatchDirect(94, 2, 0, W_LumpForHandle(&m_doom)->data);
 }
 
 //
@@ -827,8 +856,8 @@ M_DrawMainMenu(void) {
 //
 void
 M_DrawNewGame(void) {
-	V_DrawPatchDirect(96, 14, 0, W_LumpForName("M_NEWG")->data);
-	V_DrawPatchDirect(54, 38, 0, W_LumpForName("M_SKILL")->data);
+	V_DrawPatchDirect(96, 14, 0, W_LumpForHandle(&m_newg)->data);
+	V_DrawPatchDirect(54, 38, 0, W_LumpForHandle(&m_skill)->data);
 }
 
 void
@@ -851,7 +880,7 @@ int epi;
 
 void
 M_DrawEpisode(void) {
-	V_DrawPatchDirect(54, 38, 0, W_LumpForName("M_EPISOD")->data);
+	V_DrawPatchDirect(54, 38, 0, W_LumpForHandle(&m_episod)->data);
 }
 
 void
@@ -898,16 +927,16 @@ M_Episode(int choice) {
 //
 // M_Options
 //
-char detailNames[2][9] = { "M_GDHIGH", "M_GDLOW" };
-char msgNames[2][9]    = { "M_MSGOFF", "M_MSGON" };
+static struct w_handle detailNames[2] = { W_HANDLE("M_GDHIGH"), W_HANDLE("M_GDLOW") };
+static struct w_handle msgNames[2]    = { W_HANDLE("M_MSGOFF"), W_HANDLE("M_MSGON") };
 
 void
 M_DrawOptions(void) {
-	V_DrawPatchDirect(108, 15, 0, W_LumpForName("M_OPTTTL")->data);
+	V_DrawPatchDirect(108, 15, 0, W_LumpForHandle(&m_optttl)->data);
 
-	V_DrawPatchDirect(OptionsDef.x + 175, OptionsDef.y + LINEHEIGHT * detail, 0, W_LumpForName(detailNames[detailLevel])->data);
+	V_DrawPatchDirect(OptionsDef.x + 175, OptionsDef.y + LINEHEIGHT * detail, 0, W_LumpForHandle(&detailNames[detailLevel])->data);
 
-	V_DrawPatchDirect(OptionsDef.x + 120, OptionsDef.y + LINEHEIGHT * messages, 0, W_LumpForName(msgNames[showMessages])->data);
+	V_DrawPatchDirect(OptionsDef.x + 120, OptionsDef.y + LINEHEIGHT * messages, 0, W_LumpForHandle(&msgNames[showMessages])->data);
 
 	M_DrawThermo(OptionsDef.x, OptionsDef.y + LINEHEIGHT * (mousesens + 1), 10, mouseSensitivity);
 
@@ -1101,27 +1130,27 @@ M_DrawThermo(int x,
 	int i;
 
 	xx = x;
-	V_DrawPatchDirect(xx, y, 0, W_LumpForName("M_THERML")->data);
+	V_DrawPatchDirect(xx, y, 0, W_LumpForHandle(&m_therml)->data);
 	xx += 8;
 	for(i = 0; i < thermWidth; i++) {
-		V_DrawPatchDirect(xx, y, 0, W_LumpForName("M_THERMM")->data);
+		V_DrawPatchDirect(xx, y, 0, W_LumpForHandle(&m_thermm)->data);
 		xx += 8;
 	}
-	V_DrawPatchDirect(xx, y, 0, W_LumpForName("M_THERMR")->data);
+	V_DrawPatchDirect(xx, y, 0, W_LumpForHandle(&m_thermr)->data);
 
-	V_DrawPatchDirect((x + 8) + thermDot * 8, y, 0, W_LumpForName("M_THERMO")->data);
+	V_DrawPatchDirect((x + 8) + thermDot * 8, y, 0, W_LumpForHandle(&m_thermo)->data);
 }
 
 void
 M_DrawEmptyCell(menu_t *menu,
 	int item) {
-	V_DrawPatchDirect(menu->x - 10, menu->y + item * LINEHEIGHT - 1, 0, W_LumpForName("M_CELL1")->data);
+	V_DrawPatchDirect(menu->x - 10, menu->y + item * LINEHEIGHT - 1, 0, W_LumpForHandle(&m_cell1)->data);
 }
 
 void
 M_DrawSelCell(menu_t *menu,
 	int item) {
-	V_DrawPatchDirect(menu->x - 10, menu->y + item * LINEHEIGHT - 1, 0, W_LumpForName("M_CELL2")->data);
+	V_DrawPatchDirect(menu->x - 10, menu->y + item * LINEHEIGHT - 1, 0, W_LumpForHandle(&m_cell2)->data);
 }
 
 void
@@ -1226,10 +1255,10 @@ M_WriteText(int x,
 //
 
 //
-// M_Responder
+// M_Respond
 //
-boolean
-M_Responder(event_t *ev) {
+static boolean
+M_Respond(event_t *ev) {
 	int ch;
 	int i;
 	static int joywait   = 0;
@@ -1445,7 +1474,7 @@ M_Responder(event_t *ev) {
 			if(usegamma > 4)
 				usegamma = 0;
 			players[consoleplayer].message = gammamsg[usegamma];
-			I_SetPalette(W_LumpForName("PLAYPAL")->data);
+			I_SetPalette(W_LumpForHandle(&playpal)->data);
 			return true;
 		}
 
@@ -1542,6 +1571,19 @@ M_Responder(event_t *ev) {
 	return false;
 }
 
+//
+// M_Responder
+// Anything eaten may have changed what is drawn.
+//
+boolean
+M_Responder(event_t *ev) {
+	if(!M_Respond(ev))
+		return false;
+
+	menuchanged = true;
+	return true;
+}
+
 //
 // M_StartControlPanel
 //
@@ -1556,6 +1598,40 @@ M_StartControlPanel(void) {
 	itemOn      = currentMenu->lastOn; // JDC
 }
 
+//
+// M_Changed
+// Whether M_Drawer would draw anything
+// different since last asked.
+//
+boolean
+M_Changed(void) {
+	static boolean lastmenuactive;
+	static int lastmessageToPrint;
+	static const char *lastmessageString;
+	static const menu_t *lastmenu;
+	static short lastitemOn;
+	static short lastwhichSkull;
+	boolean changed;
+
+	changed = menuchanged
+		|| menuactive != lastmenuactive
+		|| messageToPrint != lastmessageToPrint
+		|| messageString != lastmessageString
+		|| currentMenu != lastmenu
+		|| itemOn != lastitemOn
+		|| whichSkull != lastwhichSkull;
+
+	menuchanged        = false;
+	lastmenuactive     = menuactive;
+	lastmessageToPrint = messageToPrint;
+	lastmessageString  = messageString;
+	lastmenu           = currentMenu;
+	lastitemOn         = itemOn;
+	lastwhichSkull     = whichSkull;
+
+	return changed;
+}
+
 //
 // M_Drawer
 // Called after the view has been rendered,
@@ -1609,13 +1685,18 @@ M_Drawer(void) {
 	max = currentMenu->numitems;
 
 	for(i = 0; i < max; i++) {
-		if(currentMenu->menuitems[i].name[0])
-			V_DrawPatchDirect(x, y, 0, W_LumpForName(currentMenu->menuitems[i].name)->data);
+		menuitem_t *item = &currentMenu->menuitems[i];
+
+		if(item->name[0]) {
+			if(item->lump == NULL)
+				item->lump = W_LumpForName(item->name);
+			V_DrawPatchDirect(x, y, 0, item->lump->data);
+		}
 		y += LINEHEIGHT;
 	}
 
 	// DRAW SKULL
-	V_DrawPatchDirect(x + SKULLXOFF, currentMenu->y - 5 + itemOn * LINEHEIGHT, 0, W_LumpForName(skullName[whichSkull])->data);
+	V_DrawPatchDirect(x + SKULLXOFF, currentMenu->y - 5 + itemOn * LINEHEIGHT, 0, W_LumpForHandle(&skulls[whichSkull])->data);
 }
 
 //
@@ -37,10 +37,15 @@ void
 M_Ticker(void);
 
 // Called by main loop,
-// draws the menus directly into the screen buffer.
+// draws the menus into the overlay.
 void
 M_Drawer(void);
 
+// Called by main loop before redrawing the overlay,
+// whether M_Drawer would draw anything different.
+boolean
+M_Changed(void);
+
 // Called by D_DoomMain,
 // loads the config file.
 void
@@ -27,6 +27,8 @@
 #include <unistd.h>
 
 #include <ctype.h>
+#include <stdio.h>
+#include <errno.h>
 
 #include "doomdef.h"
 
@@ -142,6 +144,80 @@ M_ReadFile(char const *name,
 	return length;
 }
 
+//
+// M_Hash
+//
+uint64_t
+M_Hash(const void *data,
+	size_t length,
+	uint64_t hash) {
+	const byte *p = data;
+
+	while(length--) {
+		hash ^= *p++;
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+//
+// M_CachePath
+// The cache lives in -cachedir, or $HOME/.rdoom.
+// Files in it can be deleted at any time.
+//
+boolean
+M_CachePath(char *path,
+	size_t size,
+	const char *name) {
+	char dir[1024];
+	const char *home;
+	int p;
+
+	p = M_CheckParm("-cachedir");
+	if(p && p < myargc - 1) {
+		snprintf(dir, sizeof(dir), "%s", myargv[p + 1]);
+	} else {
+		home = getenv("HOME");
+		if(home == NULL)
+			return false;
+		snprintf(dir, sizeof(dir), "%s/.rdoom", home);
+	}
+
+	if(mkdir(dir, 0777) == -1 && errno != EEXIST)
+		return false;
+
+	return snprintf(path, size, "%s/%s", dir, name) < (int)size;
+}
+
+//
+// M_CacheCreate
+// Readers never see a partially written file,
+//  nor one truncated under their mapping.
+//
+FILE *
+M_CacheCreate(const char *path,
+	char *tmp,
+	size_t size) {
+	FILE *file;
+	int fd;
+
+	if(snprintf(tmp, size, "%s.XXXXXX", path) >= (int)size)
+		return NULL;
+
+	fd = mkstemp(tmp);
+	if(fd == -1)
+		return NULL;
+
+	file = fdopen(fd, "wb");
+	if(file == NULL) {
+		close(fd);
+		remove(tmp);
+	}
+
+	return file;
+}
+
 //
 // DEFAULTS
 //
@@ -180,6 +256,13 @@ extern int detailLevel;
 
 extern int screenblocks;
 
+extern int flatcachekb;
+
+extern int governorfps;
+
+extern int zonesoftmb;
+extern int zonemaxmb;
+
 extern int showMessages;
 
 // machine-independent sound params
@@ -187,6 +270,7 @@ extern int numChannels;
 
 #ifdef NORMALUNIX
 extern int mb_used;
+extern int usehugepages;
 #endif
 
 #ifdef LINUX
@@ -223,6 +307,7 @@ default_t defaults[] = {
 	{ "key_speed", &key_speed, KEY_RSHIFT },
 
 	{ "mb_used", &mb_used, 2 },
+	{ "use_hugepages", &usehugepages, 0 },
 #endif
 
 	{ "use_mouse", &usemouse, 1 },
@@ -242,6 +327,11 @@ default_t defaults[] = {
 	{ "snd_channels", &numChannels, 3 },
 
 	{ "usegamma", &usegamma, 0 },
+
+	{ "flatcache_kb", &flatcachekb, 1024 },
+	{ "governor_fps", &governorfps, 0 },
+	{ "zone_soft_mb", &zonesoftmb, 64 },
+	{ "zone_max_mb", &zonemaxmb, 512 },
 };
 
 typedef struct
@@ -18,6 +18,9 @@
 #ifndef __M_MISC__
 #define __M_MISC__
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "doomtype.h"
 //
 // MISC
@@ -35,6 +38,28 @@ M_ReadFile(char const *name,
 void
 M_ScreenShot(void);
 
+// FNV-1a, chain calls by passing the previous hash.
+#define M_HASHINIT 0xcbf29ce484222325ull
+
+uint64_t
+M_Hash(const void *data,
+	size_t length,
+	uint64_t hash);
+
+// Path of a named file in the on-disk cache,
+//  false if there is no usable cache directory.
+boolean
+M_CachePath(char *path,
+	size_t size,
+	const char *name);
+
+// Temporary file next to a cache path, its name is
+//  written in tmp, rename it over path once complete.
+FILE *
+M_CacheCreate(const char *path,
+	char *tmp,
+	size_t size);
+
 void
 M_LoadDefaults(void);
 
@@ -34,6 +34,7 @@
 //
 
 ceiling_t *activeceilings[MAXCEILINGS];
+zpool_t ceilingpool = Z_POOL(ceiling_t, 32, PU_LEVSPEC);
 
 //
 // T_MoveCeiling
@@ -177,7 +178,7 @@ EV_DoCeiling(line_t *line,
 
 		// new door thinker
 		rtn     = 1;
-		ceiling = Z_Malloc(sizeof(*ceiling), PU_LEVSPEC, 0);
+		ceiling = Z_PoolAlloc(&ceilingpool);
 		P_AddThinker(&ceiling->thinker);
 		sec->specialdata               = ceiling;
 		ceiling->thinker.function.acp1 = (actionf_p1)T_MoveCeiling;
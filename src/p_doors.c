@@ -30,6 +30,8 @@
 #include "dstrings.h"
 #include "sounds.h"
 
+zpool_t doorpool = Z_POOL(vldoor_t, 32, PU_LEVSPEC);
+
 #if 0
 //
 // Sliding door frame information
@@ -250,7 +252,7 @@ EV_DoDoor(line_t *line,
 
 		// new door thinker
 		rtn  = 1;
-		door = Z_Malloc(sizeof(*door), PU_LEVSPEC, 0);
+		door = Z_PoolAlloc(&doorpool);
 		P_AddThinker(&door->thinker);
 		sec->specialdata = door;
 
@@ -410,7 +412,7 @@ EV_VerticalDoor(line_t *line,
 	}
 
 	// new door thinker
-	door = Z_Malloc(sizeof(*door), PU_LEVSPEC, 0);
+	door = Z_PoolAlloc(&doorpool);
 	P_AddThinker(&door->thinker);
 	sec->specialdata            = door;
 	door->thinker.function.acp1 = (actionf_p1)T_VerticalDoor;
@@ -458,7 +460,7 @@ void
 P_SpawnDoorCloseIn30(sector_t *sec) {
 	vldoor_t *door;
 
-	door = Z_Malloc(sizeof(*door), PU_LEVSPEC, 0);
+	door = Z_PoolAlloc(&doorpool);
 
 	P_AddThinker(&door->thinker);
 
@@ -481,7 +483,7 @@ P_SpawnDoorRaiseIn5Mins(sector_t *sec,
 	int secnum) {
 	vldoor_t *door;
 
-	door = Z_Malloc(sizeof(*door), PU_LEVSPEC, 0);
+	door = Z_PoolAlloc(&doorpool);
 
 	P_AddThinker(&door->thinker);
 
@@ -29,6 +29,8 @@
 // Data.
 #include "sounds.h"
 
+zpool_t floorpool = Z_POOL(floormove_t, 32, PU_LEVSPEC);
+
 //
 // FLOORS
 //
@@ -236,7 +238,7 @@ EV_DoFloor(line_t *line,
 
 		// new floor thinker
 		rtn   = 1;
-		floor = Z_Malloc(sizeof(*floor), PU_LEVSPEC, 0);
+		floor = Z_PoolAlloc(&floorpool);
 		P_AddThinker(&floor->thinker);
 		sec->specialdata             = floor;
 		floor->thinker.function.acp1 = (actionf_p1)T_MoveFloor;
@@ -405,7 +407,7 @@ EV_BuildStairs(line_t *line,
 
 		// new floor thinker
 		rtn   = 1;
-		floor = Z_Malloc(sizeof(*floor), PU_LEVSPEC, 0);
+		floor = Z_PoolAlloc(&floorpool);
 		P_AddThinker(&floor->thinker);
 		sec->specialdata             = floor;
 		floor->thinker.function.acp1 = (actionf_p1)T_MoveFloor;
@@ -455,7 +457,7 @@ EV_BuildStairs(line_t *line,
 
 				sec    = tsec;
 				secnum = newsecnum;
-				floor  = Z_Malloc(sizeof(*floor), PU_LEVSPEC, 0);
+				floor  = Z_PoolAlloc(&floorpool);
 
 				P_AddThinker(&floor->thinker);
 
@@ -27,6 +27,11 @@
 // State.
 #include "r_state.h"
 
+zpool_t flickerpool = Z_POOL(fireflicker_t, 32, PU_LEVSPEC);
+zpool_t flashpool   = Z_POOL(lightflash_t, 32, PU_LEVSPEC);
+zpool_t strobepool  = Z_POOL(strobe_t, 32, PU_LEVSPEC);
+zpool_t glowpool    = Z_POOL(glow_t, 32, PU_LEVSPEC);
+
 //
 // FIRELIGHT FLICKER
 //
@@ -62,7 +67,7 @@ P_SpawnFireFlicker(sector_t *sector) {
 	// Nothing special about it during gameplay.
 	sector->special = 0;
 
-	flick = Z_Malloc(sizeof(*flick), PU_LEVSPEC, 0);
+	flick = Z_PoolAlloc(&flickerpool);
 
 	P_AddThinker(&flick->thinker);
 
@@ -107,7 +112,7 @@ P_SpawnLightFlash(sector_t *sector) {
 	// nothing special about it during gameplay
 	sector->special = 0;
 
-	flash = Z_Malloc(sizeof(*flash), PU_LEVSPEC, 0);
+	flash = Z_PoolAlloc(&flashpool);
 
 	P_AddThinker(&flash->thinker);
 
@@ -153,7 +158,7 @@ P_SpawnStrobeFlash(sector_t *sector,
 	int inSync) {
 	strobe_t *flash;
 
-	flash = Z_Malloc(sizeof(*flash), PU_LEVSPEC, 0);
+	flash = Z_PoolAlloc(&strobepool);
 
 	P_AddThinker(&flash->thinker);
 
@@ -291,7 +296,7 @@ void
 P_SpawnGlowingLight(sector_t *sector) {
 	glow_t *g;
 
-	g = Z_Malloc(sizeof(*g), PU_LEVSPEC, 0);
+	g = Z_PoolAlloc(&glowpool);
 
 	P_AddThinker(&g->thinker);
 
@@ -22,6 +22,8 @@
 #include "r_local.h"
 #endif
 
+#include "z_zone.h"
+
 #define FLOATSPEED (FRACUNIT * 4)
 
 #define MAXHEALTH 100
@@ -92,6 +94,9 @@ P_PlayerThink(player_t *player);
 // Time interval for item respawning.
 #define ITEMQUESIZE 128
 
+// Pool of all mobjs.
+extern zpool_t mobjpool;
+
 extern mapthing_t itemrespawnque[ITEMQUESIZE];
 extern int itemrespawntime[ITEMQUESIZE];
 extern int iquehead;
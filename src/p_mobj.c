@@ -415,6 +415,10 @@ P_MobjThinker(mobj_t *mobj) {
 	}
 }
 
+// Mobjs are contiguous in slabs of this pool,
+//  the most recently removed ones reused first.
+zpool_t mobjpool = Z_POOL(mobj_t, 128, PU_LEVEL);
+
 //
 // P_SpawnMobj
 //
@@ -427,7 +431,7 @@ P_SpawnMobj(fixed_t x,
 	state_t *st;
 	mobjinfo_t *info;
 
-	mobj = Z_Malloc(sizeof(*mobj), PU_LEVEL, NULL);
+	mobj = Z_PoolAlloc(&mobjpool);
 	memset(mobj, 0, sizeof(*mobj));
 	info = &mobjinfo[type];
 
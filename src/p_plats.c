@@ -34,6 +34,7 @@
 #include "sounds.h"
 
 plat_t *activeplats[MAXPLATS];
+zpool_t platpool = Z_POOL(plat_t, 32, PU_LEVSPEC);
 
 //
 // Move a plat up and down
@@ -145,7 +146,7 @@ EV_DoPlat(line_t *line,
 
 		// Find lowest & highest floors around sector
 		rtn  = 1;
-		plat = Z_Malloc(sizeof(*plat), PU_LEVSPEC, 0);
+		plat = Z_PoolAlloc(&platpool);
 		P_AddThinker(&plat->thinker);
 
 		plat->type                  = type;
@@ -241,7 +241,7 @@ P_UnArchiveThinkers(void) {
 		if(currentthinker->function.acp1 == (actionf_p1)P_MobjThinker)
 			P_RemoveMobj((mobj_t *)currentthinker);
 		else
-			Z_Free(currentthinker);
+			Z_PoolFree(currentthinker);
 
 		currentthinker = next;
 	}
@@ -256,7 +256,7 @@ P_UnArchiveThinkers(void) {
 
 		case tc_mobj:
 			PADSAVEP();
-			mobj = Z_Malloc(sizeof(*mobj), PU_LEVEL, NULL);
+			mobj = Z_PoolAlloc(&mobjpool);
 			memcpy(mobj, save_p, sizeof(*mobj));
 			save_p += sizeof(*mobj);
 			mobj->state  = &states[(intptr_t)mobj->state];
@@ -433,7 +433,7 @@ P_UnArchiveSpecials(void) {
 
 		case tc_ceiling:
 			PADSAVEP();
-			ceiling = Z_Malloc(sizeof(*ceiling), PU_LEVEL, NULL);
+			ceiling = Z_PoolAlloc(&ceilingpool);
 			memcpy(ceiling, save_p, sizeof(*ceiling));
 			save_p += sizeof(*ceiling);
 			ceiling->sector              = &sectors[(intptr_t)ceiling->sector];
@@ -448,7 +448,7 @@ P_UnArchiveSpecials(void) {
 
 		case tc_door:
 			PADSAVEP();
-			door = Z_Malloc(sizeof(*door), PU_LEVEL, NULL);
+			door = Z_PoolAlloc(&doorpool);
 			memcpy(door, save_p, sizeof(*door));
 			save_p += sizeof(*door);
 			door->sector                = &sectors[(intptr_t)door->sector];
@@ -459,7 +459,7 @@ P_UnArchiveSpecials(void) {
 
 		case tc_floor:
 			PADSAVEP();
-			floor = Z_Malloc(sizeof(*floor), PU_LEVEL, NULL);
+			floor = Z_PoolAlloc(&floorpool);
 			memcpy(floor, save_p, sizeof(*floor));
 			save_p += sizeof(*floor);
 			floor->sector                = &sectors[(intptr_t)floor->sector];
@@ -470,7 +470,7 @@ P_UnArchiveSpecials(void) {
 
 		case tc_plat:
 			PADSAVEP();
-			plat = Z_Malloc(sizeof(*plat), PU_LEVEL, NULL);
+			plat = Z_PoolAlloc(&platpool);
 			memcpy(plat, save_p, sizeof(*plat));
 			save_p += sizeof(*plat);
 			plat->sector              = &sectors[(intptr_t)plat->sector];
@@ -485,7 +485,7 @@ P_UnArchiveSpecials(void) {
 
 		case tc_flash:
 			PADSAVEP();
-			flash = Z_Malloc(sizeof(*flash), PU_LEVEL, NULL);
+			flash = Z_PoolAlloc(&flashpool);
 			memcpy(flash, save_p, sizeof(*flash));
 			save_p += sizeof(*flash);
 			flash->sector                = &sectors[(intptr_t)flash->sector];
@@ -495,7 +495,7 @@ P_UnArchiveSpecials(void) {
 
 		case tc_strobe:
 			PADSAVEP();
-			strobe = Z_Malloc(sizeof(*strobe), PU_LEVEL, NULL);
+			strobe = Z_PoolAlloc(&strobepool);
 			memcpy(strobe, save_p, sizeof(*strobe));
 			save_p += sizeof(*strobe);
 			strobe->sector                = &sectors[(intptr_t)strobe->sector];
@@ -505,7 +505,7 @@ P_UnArchiveSpecials(void) {
 
 		case tc_glow:
 			PADSAVEP();
-			glow = Z_Malloc(sizeof(*glow), PU_LEVEL, NULL);
+			glow = Z_PoolAlloc(&glowpool);
 			memcpy(glow, save_p, sizeof(*glow));
 			save_p += sizeof(*glow);
 			glow->sector                = &sectors[(intptr_t)glow->sector];
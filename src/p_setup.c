@@ -19,11 +19,14 @@
 //-----------------------------------------------------------------------------
 
 #include <math.h>
+#include <stdint.h>
 
 #include "z_zone.h"
 
 #include "m_swap.h"
 #include "m_bbox.h"
+#include "m_argv.h"
+#include "m_misc.h"
 
 #include "g_game.h"
 
@@ -35,6 +38,8 @@
 
 #include "s_sound.h"
 
+#include "r_pvs.h"
+
 #include "doomstat.h"
 
 void
@@ -65,6 +70,41 @@ line_t *lines;
 int numsides;
 side_t *sides;
 
+// All of the above, released with PU_LEVEL.
+static zarena_t levelarena;
+
+// Bumped whenever the loaded structures change, invalidates the cache.
+#define LEVEL_VERSION 1
+
+// Arena offsets plus one in the cache, zero is NULL.
+#define P_RELOCATE(p, delta) ((p) = (p) == NULL ? NULL : (void *)((uintptr_t)(p) + (delta)))
+
+// The cached arena, from the end of the blocklinks to its end.
+struct p_levelheader {
+	char magic[4];
+	int32_t version;
+	uint64_t key;
+	int32_t start;
+	int32_t end;
+
+	int32_t numvertexes;
+	int32_t numsegs;
+	int32_t numsectors;
+	int32_t numsubsectors;
+	int32_t numnodes;
+	int32_t numlines;
+	int32_t numsides;
+
+	// arena offsets
+	int32_t vertexes;
+	int32_t segs;
+	int32_t sectors;
+	int32_t subsectors;
+	int32_t nodes;
+	int32_t lines;
+	int32_t sides;
+};
+
 // BLOCKMAP
 // Created from axis aligned bounding box
 // of the map, a rectangular array of
@@ -114,7 +154,7 @@ P_LoadVertexes(lumpId_t id) {
 	numvertexes = lump->size / sizeof(mapvertex_t);
 
 	// Allocate zone memory for buffer.
-	vertexes = Z_Malloc(numvertexes * sizeof(vertex_t), PU_LEVEL, 0);
+	vertexes = Z_ArenaAlloc(&levelarena, numvertexes * sizeof(vertex_t));
 
 	ml = (const mapvertex_t *)lump->data;
 	li = vertexes;
@@ -141,7 +181,7 @@ P_LoadSegs(lumpId_t id) {
 	int side;
 
 	numsegs = lump->size / sizeof(mapseg_t);
-	segs    = Z_Malloc(numsegs * sizeof(seg_t), PU_LEVEL, 0);
+	segs    = Z_ArenaAlloc(&levelarena, numsegs * sizeof(seg_t));
 	memset(segs, 0, numsegs * sizeof(seg_t));
 
 	ml = (const mapseg_t *)lump->data;
@@ -176,7 +216,7 @@ P_LoadSubsectors(lumpId_t id) {
 	subsector_t *ss;
 
 	numsubsectors = lump->size / sizeof(mapsubsector_t);
-	subsectors    = Z_Malloc(numsubsectors * sizeof(subsector_t), PU_LEVEL, 0);
+	subsectors    = Z_ArenaAlloc(&levelarena, numsubsectors * sizeof(subsector_t));
 
 	ms = (const mapsubsector_t *)lump->data;
 	memset(subsectors, 0, numsubsectors * sizeof(subsector_t));
@@ -199,7 +239,7 @@ P_LoadSectors(lumpId_t id) {
 	sector_t *ss;
 
 	numsectors = lump->size / sizeof(mapsector_t);
-	sectors    = Z_Malloc(numsectors * sizeof(sector_t), PU_LEVEL, 0);
+	sectors    = Z_ArenaAlloc(&levelarena, numsectors * sizeof(sector_t));
 	memset(sectors, 0, numsectors * sizeof(sector_t));
 
 	ms = (const mapsector_t *)lump->data;
@@ -229,7 +269,7 @@ P_LoadNodes(lumpId_t id) {
 	node_t *no;
 
 	numnodes = lump->size / sizeof(mapnode_t);
-	nodes    = Z_Malloc(numnodes * sizeof(node_t), PU_LEVEL, 0);
+	nodes    = Z_ArenaAlloc(&levelarena, numnodes * sizeof(node_t));
 
 	mn = (const mapnode_t *)lump->data;
 	no = nodes;
@@ -308,7 +348,7 @@ P_LoadLineDefs(lumpId_t id) {
 	vertex_t *v2;
 
 	numlines = lump->size / sizeof(maplinedef_t);
-	lines    = Z_Malloc(numlines * sizeof(line_t), PU_LEVEL, 0);
+	lines    = Z_ArenaAlloc(&levelarena, numlines * sizeof(line_t));
 	memset(lines, 0, numlines * sizeof(line_t));
 
 	mld = (const maplinedef_t *)lump->data;
@@ -375,7 +415,7 @@ P_LoadSideDefs(lumpId_t id) {
 	side_t *sd;
 
 	numsides = lump->size / sizeof(mapsidedef_t);
-	sides    = Z_Malloc(numsides * sizeof(side_t), PU_LEVEL, 0);
+	sides    = Z_ArenaAlloc(&levelarena, numsides * sizeof(side_t));
 	memset(sides, 0, numsides * sizeof(side_t));
 
 	msd = (const mapsidedef_t *)lump->data;
@@ -408,7 +448,7 @@ P_LoadBlockMap(lumpId_t id) {
 
 	// clear out mobj chains
 	count      = sizeof(*blocklinks) * bmapwidth * bmapheight;
-	blocklinks = Z_Malloc(count, PU_LEVEL, 0);
+	blocklinks = Z_ArenaAlloc(&levelarena, count);
 	memset(blocklinks, 0, count);
 }
 
@@ -450,22 +490,31 @@ P_GroupLines(void) {
 		}
 	}
 
-	// build line tables for each sector
-	linebuffer = Z_Malloc(total * sizeof(*linebuffer), PU_LEVEL, 0);
+	// build line tables for each sector, in line order
+	linebuffer = Z_ArenaAlloc(&levelarena, total * sizeof(*linebuffer));
 	sector     = sectors;
+	for(i = 0; i < numsectors; i++, sector++) {
+		sector->lines     = linebuffer;
+		linebuffer       += sector->linecount;
+		sector->linecount = 0;
+	}
+
+	li = lines;
+	for(i = 0; i < numlines; i++, li++) {
+		li->frontsector->lines[li->frontsector->linecount++] = li;
+
+		if(li->backsector && li->backsector != li->frontsector)
+			li->backsector->lines[li->backsector->linecount++] = li;
+	}
+
+	sector = sectors;
 	for(i = 0; i < numsectors; i++, sector++) {
 		M_ClearBox(bbox);
-		sector->lines = linebuffer;
-		li            = lines;
-		for(j = 0; j < numlines; j++, li++) {
-			if(li->frontsector == sector || li->backsector == sector) {
-				*linebuffer++ = li;
-				M_AddToBox(bbox, li->v1->x, li->v1->y);
-				M_AddToBox(bbox, li->v2->x, li->v2->y);
-			}
+		for(j = 0; j < sector->linecount; j++) {
+			li = sector->lines[j];
+			M_AddToBox(bbox, li->v1->x, li->v1->y);
+			M_AddToBox(bbox, li->v2->x, li->v2->y);
 		}
-		if(linebuffer - sector->lines != sector->linecount)
-			I_Error("P_GroupLines: miscounted");
 
 		// set the degenmobj_t to the middle of the bounding box
 		sector->soundorg.x = (bbox[BOXRIGHT] + bbox[BOXLEFT]) / 2;
@@ -490,6 +539,224 @@ P_GroupLines(void) {
 	}
 }
 
+//
+// P_LevelArenaSize
+// Bytes of the level arena, from the map lumps sizes.
+//
+static int
+P_LevelArenaSize(lumpId_t lumpnum) {
+	const short *blockmap;
+	int numlinedefs;
+	int size;
+
+	blockmap    = W_LumpForId(lumpnum + ML_BLOCKMAP)->data;
+	numlinedefs = W_LumpForId(lumpnum + ML_LINEDEFS)->size / sizeof(maplinedef_t);
+
+	size = Z_ARENASIZE(SHORT(blockmap[2]) * SHORT(blockmap[3]) * sizeof(*blocklinks));
+	size += Z_ARENASIZE(W_LumpForId(lumpnum + ML_VERTEXES)->size / sizeof(mapvertex_t) * sizeof(vertex_t));
+	size += Z_ARENASIZE(W_LumpForId(lumpnum + ML_SECTORS)->size / sizeof(mapsector_t) * sizeof(sector_t));
+	size += Z_ARENASIZE(W_LumpForId(lumpnum + ML_SIDEDEFS)->size / sizeof(mapsidedef_t) * sizeof(side_t));
+	size += Z_ARENASIZE(numlinedefs * sizeof(line_t));
+	size += Z_ARENASIZE(W_LumpForId(lumpnum + ML_NODES)->size / sizeof(mapnode_t) * sizeof(node_t));
+	size += Z_ARENASIZE(W_LumpForId(lumpnum + ML_SSECTORS)->size / sizeof(mapsubsector_t) * sizeof(subsector_t));
+	size += Z_ARENASIZE(W_LumpForId(lumpnum + ML_SEGS)->size / sizeof(mapseg_t) * sizeof(seg_t));
+
+	// P_GroupLines, each line in at most two sectors
+	size += Z_ARENASIZE(numlinedefs * 2 * sizeof(line_t *));
+
+	return size;
+}
+
+//
+// P_LevelKey
+// Everything the loaded level depends on,
+//  the map lumps and the texture and flat numbering.
+//
+static uint64_t
+P_LevelKey(lumpId_t lumpnum) {
+	static const int maplumps[] = {
+		ML_LINEDEFS, ML_SIDEDEFS, ML_VERTEXES, ML_SEGS,
+		ML_SSECTORS, ML_NODES, ML_SECTORS, ML_BLOCKMAP
+	};
+	static const char *texturelumps[] = { "TEXTURE1", "TEXTURE2" };
+	int32_t header[] = {
+		LEVEL_VERSION, sizeof(void *), sizeof(vertex_t), sizeof(seg_t), sizeof(sector_t),
+		sizeof(subsector_t), sizeof(node_t), sizeof(line_t), sizeof(side_t), numflats
+	};
+	const struct w_lump *lump;
+	uint64_t key = M_HASHINIT;
+	lumpId_t id;
+	int i;
+
+	key = M_Hash(header, sizeof(header), key);
+	for(i = 0; i < (int)(sizeof(maplumps) / sizeof(*maplumps)); i++) {
+		lump = W_LumpForId(lumpnum + maplumps[i]);
+		key  = M_Hash(lump->data, lump->size, key);
+	}
+
+	for(i = 0; i < (int)(sizeof(texturelumps) / sizeof(*texturelumps)); i++) {
+		id = W_FindIdForName(texturelumps[i]);
+		if(id != -1) {
+			lump = W_LumpForId(id);
+			key  = M_Hash(lump->data, lump->size, key);
+		}
+	}
+
+	for(i = 0; i < numflats; i++)
+		key = M_Hash(W_LumpForId(flatlumps[i])->name, 8, key);
+
+	return key;
+}
+
+//
+// P_RelocateLevel
+// Turns the pointers into the level arena into offsets
+//  for the cache, or back into pointers once loaded.
+//
+static void
+P_RelocateLevel(boolean load) {
+	const uintptr_t delta = load ? (uintptr_t)levelarena.base - 1 : 1 - (uintptr_t)levelarena.base;
+	sector_t *sector;
+	side_t *side;
+	line_t *line;
+	subsector_t *ss;
+	seg_t *seg;
+	int i;
+	int j;
+
+	for(i = 0, sector = sectors; i < numsectors; i++, sector++) {
+		if(load)
+			P_RELOCATE(sector->lines, delta);
+		for(j = 0; j < sector->linecount; j++)
+			P_RELOCATE(sector->lines[j], delta);
+		if(!load)
+			P_RELOCATE(sector->lines, delta);
+	}
+
+	for(i = 0, side = sides; i < numsides; i++, side++)
+		P_RELOCATE(side->sector, delta);
+
+	for(i = 0, line = lines; i < numlines; i++, line++) {
+		P_RELOCATE(line->v1, delta);
+		P_RELOCATE(line->v2, delta);
+		P_RELOCATE(line->frontsector, delta);
+		P_RELOCATE(line->backsector, delta);
+	}
+
+	for(i = 0, ss = subsectors; i < numsubsectors; i++, ss++)
+		P_RELOCATE(ss->sector, delta);
+
+	for(i = 0, seg = segs; i < numsegs; i++, seg++) {
+		P_RELOCATE(seg->v1, delta);
+		P_RELOCATE(seg->v2, delta);
+		P_RELOCATE(seg->sidedef, delta);
+		P_RELOCATE(seg->linedef, delta);
+		P_RELOCATE(seg->frontsector, delta);
+		P_RELOCATE(seg->backsector, delta);
+	}
+}
+
+//
+// P_ReadLevel
+// Maps the cache and copies it after the blocklinks,
+//  instead of converting and grouping the map lumps.
+//
+static boolean
+P_ReadLevel(const char *path,
+	uint64_t key) {
+	const struct p_levelheader *header;
+	struct i_fileMap filemap;
+	boolean valid;
+
+	if(!I_FileTryMap(path, &filemap))
+		return false;
+
+	header = filemap.address;
+	valid  = filemap.size >= sizeof(*header)
+		&& memcmp(header->magic, "RLVL", 4) == 0
+		&& header->version == LEVEL_VERSION
+		&& header->key == key
+		&& header->start == levelarena.used
+		&& header->end >= header->start
+		&& header->end <= levelarena.size
+		&& filemap.size == sizeof(*header) + header->end - header->start;
+
+	if(valid) {
+		memcpy(levelarena.base + header->start, header + 1, header->end - header->start);
+		levelarena.used = header->end;
+
+		numvertexes   = header->numvertexes;
+		numsegs       = header->numsegs;
+		numsectors    = header->numsectors;
+		numsubsectors = header->numsubsectors;
+		numnodes      = header->numnodes;
+		numlines      = header->numlines;
+		numsides      = header->numsides;
+
+		vertexes   = (vertex_t *)(levelarena.base + header->vertexes);
+		segs       = (seg_t *)(levelarena.base + header->segs);
+		sectors    = (sector_t *)(levelarena.base + header->sectors);
+		subsectors = (subsector_t *)(levelarena.base + header->subsectors);
+		nodes      = (node_t *)(levelarena.base + header->nodes);
+		lines      = (line_t *)(levelarena.base + header->lines);
+		sides      = (side_t *)(levelarena.base + header->sides);
+
+		P_RelocateLevel(true);
+	}
+
+	I_FileUnMap(&filemap);
+
+	return valid;
+}
+
+//
+// P_WriteLevel
+// Called right after P_GroupLines, before anything
+//  points into the level or the level points outside.
+//
+static void
+P_WriteLevel(const char *path,
+	uint64_t key,
+	int start) {
+	struct p_levelheader header = {
+		.magic         = { 'R', 'L', 'V', 'L' },
+		.version       = LEVEL_VERSION,
+		.key           = key,
+		.start         = start,
+		.end           = levelarena.used,
+		.numvertexes   = numvertexes,
+		.numsegs       = numsegs,
+		.numsectors    = numsectors,
+		.numsubsectors = numsubsectors,
+		.numnodes      = numnodes,
+		.numlines      = numlines,
+		.numsides      = numsides,
+		.vertexes      = (byte *)vertexes - levelarena.base,
+		.segs          = (byte *)segs - levelarena.base,
+		.sectors       = (byte *)sectors - levelarena.base,
+		.subsectors    = (byte *)subsectors - levelarena.base,
+		.nodes         = (byte *)nodes - levelarena.base,
+		.lines         = (byte *)lines - levelarena.base,
+		.sides         = (byte *)sides - levelarena.base,
+	};
+	size_t size = levelarena.used - start;
+	char tmp[1024];
+	boolean written;
+	FILE *file;
+
+	file = M_CacheCreate(path, tmp, sizeof(tmp));
+	if(file == NULL)
+		return;
+
+	P_RelocateLevel(false);
+	written = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(levelarena.base + start, 1, size, file) == size;
+	P_RelocateLevel(true);
+
+	if(fclose(file) != 0 || !written || rename(tmp, path) != 0)
+		remove(tmp);
+}
+
 //
 // P_SetupLevel
 //
@@ -501,6 +768,10 @@ P_SetupLevel(int episode,
 	int i;
 	char lumpname[9];
 	int lumpnum;
+	char name[32], path[1024];
+	boolean cached;
+	uint64_t key;
+	int start;
 
 	totalkills = totalitems = totalsecret = wminfo.maxfrags = 0;
 	wminfo.partime                                          = 180;
@@ -524,6 +795,10 @@ P_SetupLevel(int episode,
     }
     else
 #endif
+	// report what the previous level used
+	if(devparm && gamestate == GS_LEVEL)
+		Z_PrintStats();
+
 	Z_FreeTags(PU_LEVEL, PU_PURGELEVEL - 1);
 
 	// UNUSED W_Profile ();
@@ -547,19 +822,42 @@ P_SetupLevel(int episode,
 
 	leveltime = 0;
 
-	// note: most of this ordering is important
+	// a single block for the geometry,
+	//  freed with the level
+	Z_ArenaInit(&levelarena, P_LevelArenaSize(lumpnum), PU_LEVEL);
+
+	// note: most of this ordering is important,
+	//  nodes, subsectors and segs are adjacent for R_RenderBSPNode
 	P_LoadBlockMap(lumpnum + ML_BLOCKMAP);
-	P_LoadVertexes(lumpnum + ML_VERTEXES);
-	P_LoadSectors(lumpnum + ML_SECTORS);
-	P_LoadSideDefs(lumpnum + ML_SIDEDEFS);
 
-	P_LoadLineDefs(lumpnum + ML_LINEDEFS);
-	P_LoadSubsectors(lumpnum + ML_SSECTORS);
-	P_LoadNodes(lumpnum + ML_NODES);
-	P_LoadSegs(lumpnum + ML_SEGS);
+	// everything after the blocklinks comes from the level cache
+	//  when it was built from the same lumps
+	start  = levelarena.used;
+	cached = !M_CheckParm("-nolevelcache");
+	if(cached) {
+		key = P_LevelKey(lumpnum);
+		snprintf(name, sizeof(name), "level-%016llx", (unsigned long long)key);
+		cached = M_CachePath(path, sizeof(path), name);
+	}
+
+	if(!cached || !P_ReadLevel(path, key)) {
+		P_LoadVertexes(lumpnum + ML_VERTEXES);
+		P_LoadSectors(lumpnum + ML_SECTORS);
+		P_LoadSideDefs(lumpnum + ML_SIDEDEFS);
+
+		P_LoadLineDefs(lumpnum + ML_LINEDEFS);
+		P_LoadNodes(lumpnum + ML_NODES);
+		P_LoadSubsectors(lumpnum + ML_SSECTORS);
+		P_LoadSegs(lumpnum + ML_SEGS);
+
+		P_GroupLines();
+
+		if(cached)
+			P_WriteLevel(path, key, start);
+	}
 
 	rejectmatrix = W_LumpForId(lumpnum + ML_REJECT)->data;
-	P_GroupLines();
+	R_LoadPVS(lumpnum);
 
 	bodyqueslot  = 0;
 	deathmatch_p = deathmatchstarts;
@@ -153,6 +153,12 @@ typedef struct
 
 } glow_t;
 
+// Pools of the lighting thinkers.
+extern zpool_t flickerpool;
+extern zpool_t flashpool;
+extern zpool_t strobepool;
+extern zpool_t glowpool;
+
 #define GLOWSPEED 8
 #define STROBEBRIGHT 5
 #define FASTDARK 15
@@ -274,6 +280,7 @@ typedef struct
 #define MAXPLATS 30
 
 extern plat_t *activeplats[MAXPLATS];
+extern zpool_t platpool;
 
 void
 T_PlatRaise(plat_t *plat);
@@ -326,6 +333,8 @@ typedef struct
 
 } vldoor_t;
 
+extern zpool_t doorpool;
+
 #define VDOORSPEED FRACUNIT * 2
 #define VDOORWAIT 150
 
@@ -470,6 +479,7 @@ typedef struct
 #define MAXCEILINGS 30
 
 extern ceiling_t *activeceilings[MAXCEILINGS];
+extern zpool_t ceilingpool;
 
 int
 EV_DoCeiling(line_t *line,
@@ -543,6 +553,8 @@ typedef struct
 
 } floormove_t;
 
+extern zpool_t floorpool;
+
 #define FLOORSPEED FRACUNIT
 
 typedef enum {
@@ -27,7 +27,7 @@ int leveltime;
 
 //
 // THINKERS
-// All thinkers should be allocated by Z_Malloc
+// All thinkers should be allocated from a pool
 // so they can be operated on uniformly.
 // The actual structures will vary in size,
 // but the first element must be thinker_t.
@@ -81,19 +81,21 @@ P_AllocateThinker(thinker_t *thinker) {
 void
 P_RunThinkers(void) {
 	thinker_t *currentthinker;
+	thinker_t *nextthinker;
 
 	currentthinker = thinkercap.next;
 	while(currentthinker != &thinkercap) {
+		nextthinker = currentthinker->next;
 		if(currentthinker->function.acv == (actionf_v)(-1)) {
 			// time to remove it
 			currentthinker->next->prev = currentthinker->prev;
 			currentthinker->prev->next = currentthinker->next;
-			Z_Free(currentthinker);
+			Z_PoolFree(currentthinker);
 		} else {
 			if(currentthinker->function.acp1)
 				currentthinker->function.acp1(currentthinker);
 		}
-		currentthinker = currentthinker->next;
+		currentthinker = nextthinker;
 	}
 }
 
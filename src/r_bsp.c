@@ -17,6 +17,8 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdint.h>
+
 #include "doomdef.h"
 
 #include "m_bbox.h"
@@ -26,6 +28,7 @@
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_things.h"
+#include "r_pvs.h"
 
 // State.
 #include "doomstat.h"
@@ -42,6 +45,10 @@ sector_t *backsector;
 drawseg_t drawsegs[MAXDRAWSEGS];
 drawseg_t *ds_p;
 
+// just for profiling purposes
+int bspnodecount;
+int bspfullstops;
+
 void
 R_StoreWallRange(int start,
 	int stop);
@@ -72,6 +79,72 @@ typedef struct
 cliprange_t *newend;
 cliprange_t solidsegs[MAXSEGS];
 
+//
+// Occlusion bitset.
+// Mirrors solidsegs with one bit per closed column,
+//  so a bbox span is tested 64 columns at a time.
+// Once no column is left open, nothing further
+//  back can be visible and the traversal stops.
+//
+#define SOLIDBITS 64
+
+static uint64_t solidcolumns[(SCREENWIDTH + SOLIDBITS - 1) / SOLIDBITS];
+static int opencolumns;
+
+//
+// R_MarkSolidColumns
+// Closes columns first to last (inclusive).
+//
+static void
+R_MarkSolidColumns(int first,
+	int last) {
+	uint64_t mask;
+	int word;
+	int lastword;
+
+	word     = first / SOLIDBITS;
+	lastword = last / SOLIDBITS;
+	mask     = ~0ull << (first % SOLIDBITS);
+
+	for(; word <= lastword; word++) {
+		if(word == lastword)
+			mask &= ~0ull >> (SOLIDBITS - 1 - last % SOLIDBITS);
+
+		opencolumns -= __builtin_popcountll(mask & ~solidcolumns[word]);
+		solidcolumns[word] |= mask;
+		mask = ~0ull;
+	}
+}
+
+//
+// R_SolidColumns
+// Returns true if columns first to last
+//  (inclusive) are all closed.
+//
+static boolean
+R_SolidColumns(int first,
+	int last) {
+	uint64_t mask;
+	int word;
+	int lastword;
+
+	word     = first / SOLIDBITS;
+	lastword = last / SOLIDBITS;
+	mask     = ~0ull << (first % SOLIDBITS);
+
+	for(; word <= lastword; word++) {
+		if(word == lastword)
+			mask &= ~0ull >> (SOLIDBITS - 1 - last % SOLIDBITS);
+
+		if((solidcolumns[word] & mask) != mask)
+			return false;
+
+		mask = ~0ull;
+	}
+
+	return true;
+}
+
 //
 // R_ClipSolidWallSegment
 // Does handle solid walls,
@@ -84,6 +157,8 @@ R_ClipSolidWallSegment(int first,
 	cliprange_t *next;
 	cliprange_t *start;
 
+	R_MarkSolidColumns(first, last);
+
 	// Find the first range that touches the range
 	//  (adjacent pixels are touching).
 	start = solidsegs;
@@ -208,6 +283,12 @@ R_ClearClipSegs(void) {
 	solidsegs[1].first = viewwidth;
 	solidsegs[1].last  = 0x7fffffff;
 	newend             = solidsegs + 2;
+
+	memset(solidcolumns, 0, sizeof(solidcolumns));
+	opencolumns = viewwidth;
+
+	bspnodecount = 0;
+	bspfullstops = 0;
 }
 
 //
@@ -346,8 +427,6 @@ R_CheckBBox(fixed_t *bspcoord) {
 	angle_t span;
 	angle_t tspan;
 
-	cliprange_t *start;
-
 	int sx1;
 	int sx2;
 
@@ -421,17 +500,8 @@ R_CheckBBox(fixed_t *bspcoord) {
 		return false;
 	sx2--;
 
-	start = solidsegs;
-	while(start->last < sx2)
-		start++;
-
-	if(sx1 >= start->first
-		&& sx2 <= start->last) {
-		// The clippost contains the new span.
-		return false;
-	}
-
-	return true;
+	// The closed columns contain the new span?
+	return !R_SolidColumns(sx1, sx2);
 }
 
 //
@@ -453,8 +523,11 @@ R_Subsector(int num) {
 			numsubsectors);
 #endif
 
+	sub = &subsectors[num];
+	if(!R_PVSVISIBLE(sub->sector))
+		return;
+
 	sscount++;
-	sub         = &subsectors[num];
 	frontsector = sub->sector;
 	count       = sub->numlines;
 	line        = &segs[sub->firstline];
@@ -492,6 +565,12 @@ R_RenderBSPNode(int bspnum) {
 	node_t *bsp;
 	int side;
 
+	// Every column closed, nothing behind can show.
+	if(!opencolumns) {
+		bspfullstops++;
+		return;
+	}
+
 	// Found a subsector?
 	if(bspnum & NF_SUBSECTOR) {
 		if(bspnum == -1)
@@ -501,6 +580,13 @@ R_RenderBSPNode(int bspnum) {
 		return;
 	}
 
+	// Nothing below can be seen from the view sector.
+	if(pvsnodes != NULL && !pvsnodes[bspnum]) {
+		pvsculled++;
+		return;
+	}
+
+	bspnodecount++;
 	bsp = &nodes[bspnum];
 
 	// Decide which side the view point is on.
@@ -42,6 +42,11 @@ extern boolean skymap;
 extern drawseg_t drawsegs[MAXDRAWSEGS];
 extern drawseg_t *ds_p;
 
+// Per frame, nodes traversed and subtrees
+//  cut once every column was closed.
+extern int bspnodecount;
+extern int bspfullstops;
+
 extern const lighttable_t **hscalelight;
 extern const lighttable_t **vscalelight;
 extern const lighttable_t **dscalelight;
@@ -21,6 +21,7 @@
 
 #include <stdint.h>
 #include <alloca.h>
+#include <pthread.h>
 
 #include "i_system.h"
 #include "z_zone.h"
@@ -111,16 +112,14 @@ typedef struct
 
 } texture_t;
 
-int firstflat;
-int lastflat;
+const lumpId_t *flatlumps;
 int numflats;
 
 int firstpatch;
 int lastpatch;
 int numpatches;
 
-int firstspritelump;
-int lastspritelump;
+const lumpId_t *spritelumps;
 int numspritelumps;
 
 int numtextures;
@@ -131,9 +130,18 @@ int *texturewidthmask;
 fixed_t *textureheight;
 int *texturecompositesize;
 short **texturecolumnlump;
-unsigned short **texturecolumnofs;
+uint32_t **texturecolumnofs;
+
+// Patch columns with their posts, for masked midtextures,
+//  -1 if covered by several patches.
+static short **texturemaskedlump;
+static uint32_t **texturemaskedofs;
 byte **texturecomposite;
 
+// Column pointers of every cached texture,
+//  NULL until R_CacheTexture, freed with the level.
+const uint8_t ***texturecolumns;
+
 // for global animation
 int *flattranslation;
 int *texturetranslation;
@@ -147,16 +155,24 @@ const lighttable_t *colormaps;
 
 //
 // MAPTEXTURE_T CACHING
-// When a texture is first needed,
-//  it counts the number of composite columns
-//  required in the texture and allocates space
-//  for a column directory and any new columns.
-// The directory will simply point inside other patches
-//  if there is only one patch in a given column,
-//  but any columns with multiple patches
-//  will have new column_ts generated.
+// Textures used by a level are cached when it is loaded,
+//  in parallel, and kept until the next one.
+// Each gets a directory of column pointers,
+//  pointing inside the patches if there is
+//  only one patch in a given column,
+//  or in a composite block for columns
+//  with multiple patches.
 //
 
+// Worker threads compositing textures at level load.
+#define MAXCOMPOSITEWORKERS 16
+
+struct r_composite {
+	const short *textures;
+	int count;
+	int next;
+};
+
 //
 // R_DrawColumnInCache
 // Clip and draw a column
@@ -194,13 +210,31 @@ R_DrawColumnInCache(column_t *patch,
 	}
 }
 
+//
+// R_AllocTexture
+// Zone allocations for R_GenerateComposite,
+//  which may not run on the main thread.
+//
+static void
+R_AllocTexture(int texnum) {
+	if(texturecompositesize[texnum] > 0) {
+		Z_Malloc(texturecompositesize[texnum],
+			PU_LEVEL,
+			&texturecomposite[texnum]);
+	}
+
+	Z_Malloc(textures[texnum]->width * sizeof(**texturecolumns),
+		PU_LEVEL,
+		&texturecolumns[texnum]);
+}
+
 //
 // R_GenerateComposite
 // Using the texture definition,
 //  the composite texture is created from the patches,
-//  and each column is cached.
+//  and the column directory filled.
 //
-void
+static void
 R_GenerateComposite(int texnum) {
 	byte *block;
 	texture_t *texture;
@@ -212,52 +246,125 @@ R_GenerateComposite(int texnum) {
 	int i;
 	column_t *patchcol;
 	short *collump;
-	unsigned short *colofs;
+	uint32_t *colofs;
+	const uint8_t **columns;
 
 	texture = textures[texnum];
-
-	block = Z_Malloc(texturecompositesize[texnum],
-		PU_STATIC,
-		&texturecomposite[texnum]);
+	block   = texturecomposite[texnum];
+	columns = texturecolumns[texnum];
 
 	collump = texturecolumnlump[texnum];
 	colofs  = texturecolumnofs[texnum];
 
-	// Composite the columns together.
-	patch = texture->patches;
-
-	for(i = 0, patch = texture->patches;
-		i < texture->patchcount;
-		i++, patch++) {
-		realpatch = W_LumpForId(patch->patch)->data;
-		x1        = patch->originx;
-		x2        = x1 + SHORT(realpatch->width);
+	if(block != NULL) {
+		// Columns without a patch stay empty.
+		memset(block, 0, texturecompositesize[texnum]);
+
+		// Composite the columns together.
+		for(i = 0, patch = texture->patches;
+			i < texture->patchcount;
+			i++, patch++) {
+			realpatch = W_LumpForId(patch->patch)->data;
+			x1        = patch->originx;
+			x2        = x1 + SHORT(realpatch->width);
+
+			if(x1 < 0)
+				x = 0;
+			else
+				x = x1;
+
+			if(x2 > texture->width)
+				x2 = texture->width;
+
+			for(; x < x2; x++) {
+				// Column does not have multiple patches?
+				if(collump[x] >= 0)
+					continue;
+
+				patchcol = (column_t *)((byte *)realpatch
+										+ LONG(realpatch->columnofs[x - x1]));
+				R_DrawColumnInCache(patchcol,
+					block + colofs[x],
+					patch->originy,
+					texture->height);
+			}
+		}
+	}
 
-		if(x1 < 0)
-			x = 0;
+	for(x = 0; x < texture->width; x++) {
+		if(collump[x] >= 0)
+			columns[x] = (const uint8_t *)W_LumpForId(collump[x])->data + colofs[x];
 		else
-			x = x1;
+			columns[x] = block + colofs[x];
+	}
+}
 
-		if(x2 > texture->width)
-			x2 = texture->width;
+//
+// R_CacheTexture
+// For textures R_PrecacheLevel could not foresee.
+//
+static const uint8_t **
+R_CacheTexture(int texnum) {
+	R_AllocTexture(texnum);
+	R_GenerateComposite(texnum);
 
-		for(; x < x2; x++) {
-			// Column does not have multiple patches?
-			if(collump[x] >= 0)
-				continue;
-
-			patchcol = (column_t *)((byte *)realpatch
-									+ LONG(realpatch->columnofs[x - x1]));
-			R_DrawColumnInCache(patchcol,
-				block + colofs[x],
-				patch->originy,
-				texture->height);
+	return texturecolumns[texnum];
+}
+
+//
+// R_CompositeWorker
+//
+static void *
+R_CompositeWorker(void *arg) {
+	struct r_composite *composite = arg;
+	int i;
+
+	while((i = __atomic_fetch_add(&composite->next, 1, __ATOMIC_RELAXED)) < composite->count)
+		R_GenerateComposite(composite->textures[i]);
+
+	return NULL;
+}
+
+//
+// R_PrecacheTextures
+//
+static void
+R_PrecacheTextures(const byte *texturepresent) {
+	pthread_t workers[MAXCOMPOSITEWORKERS];
+	struct r_composite composite;
+	short *present;
+	int numworkers;
+	int i;
+
+	// The zone is not thread safe, allocate everything first.
+	present          = Z_ScratchAlloc(&framescratch, numtextures * sizeof(*present));
+	composite.count  = 0;
+	composite.next   = 0;
+	for(i = 0; i < numtextures; i++) {
+		if(texturepresent[i] && texturecolumns[i] == NULL) {
+			R_AllocTexture(i);
+			present[composite.count++] = i;
 		}
 	}
+	composite.textures = present;
+
+	numworkers = I_GetCPUCount() - 1;
+	if(numworkers > MAXCOMPOSITEWORKERS)
+		numworkers = MAXCOMPOSITEWORKERS;
+	if(numworkers > composite.count)
+		numworkers = composite.count;
+
+	for(i = 0; i < numworkers; i++) {
+		if(pthread_create(&workers[i], NULL, R_CompositeWorker, &composite) != 0)
+			break;
+	}
+	numworkers = i;
+
+	// Main thread works too.
+	R_CompositeWorker(&composite);
 
-	// Now that the texture has been built in column cache,
-	//  it is purgable from zone memory.
-	Z_ChangeTag(block, PU_CACHE);
+	for(i = 0; i < numworkers; i++)
+		pthread_join(workers[i], NULL);
 }
 
 //
@@ -267,23 +374,31 @@ void
 R_GenerateLookup(int texnum) {
 	texture_t *texture;
 	byte *patchcount; // patchcount[texture->width]
+	byte *fullpost;   // fullpost[texture->width]
 	texpatch_t *patch;
 	const patch_t *realpatch;
+	const post_t *post;
 	int x;
 	int x1;
 	int x2;
 	int i;
 	short *collump;
-	unsigned short *colofs;
+	uint32_t *colofs;
+	short *masklump;
+	uint32_t *maskofs;
+	boolean missing;
 
 	texture = textures[texnum];
 
 	// Composited texture not created yet.
 	texturecomposite[texnum] = 0;
+	texturecolumns[texnum]   = NULL;
 
 	texturecompositesize[texnum] = 0;
 	collump                      = texturecolumnlump[texnum];
 	colofs                       = texturecolumnofs[texnum];
+	masklump                     = texturemaskedlump[texnum];
+	maskofs                      = texturemaskedofs[texnum];
 
 	// Now count the number of columns
 	//  that are covered by more than one patch.
@@ -291,6 +406,7 @@ R_GenerateLookup(int texnum) {
 	//  with only a single patch are all done.
 	patchcount = (byte *)alloca(texture->width);
 	memset(patchcount, 0, texture->width);
+	fullpost = (byte *)alloca(texture->width);
 	patch = texture->patches;
 
 	for(i = 0, patch = texture->patches;
@@ -311,30 +427,39 @@ R_GenerateLookup(int texnum) {
 			patchcount[x]++;
 			collump[x] = patch->patch;
 			colofs[x]  = LONG(realpatch->columnofs[x - x1]) + 3;
+
+			// The drawers wrap at the texture height, so the
+			//  patch column can only be used as is if a single
+			//  post covers all of it.
+			post        = (const post_t *)((const byte *)realpatch + colofs[x] - 3);
+			fullpost[x] = patch->originy == 0
+				&& post->topdelta == 0
+				&& post->length >= texture->height;
 		}
 	}
 
+	missing = false;
 	for(x = 0; x < texture->width; x++) {
-		if(!patchcount[x]) {
-			printf("R_GenerateLookup: column without a patch (%s)\n",
-				texture->name);
-			return;
-		}
-		// I_Error ("R_GenerateLookup: column without a patch");
+		// Left empty in the composite.
+		if(!patchcount[x])
+			missing = true;
 
-		if(patchcount[x] > 1) {
+		// Masked drawing walks the posts, whatever their layout.
+		masklump[x] = patchcount[x] == 1 ? collump[x] : -1;
+		maskofs[x]  = colofs[x];
+
+		if(patchcount[x] != 1 || texture->height > 128 || !fullpost[x]) {
 			// Use the cached block.
 			collump[x] = -1;
 			colofs[x]  = texturecompositesize[texnum];
-
-			if(texturecompositesize[texnum] > 0x10000 - texture->height) {
-				I_Error("R_GenerateLookup: texture %i is >64k",
-					texnum);
-			}
-
 			texturecompositesize[texnum] += texture->height;
 		}
 	}
+
+	if(missing) {
+		printf("R_GenerateLookup: column without a patch (%s)\n",
+			texture->name);
+	}
 }
 
 //
@@ -343,20 +468,28 @@ R_GenerateLookup(int texnum) {
 const uint8_t *
 R_GetColumn(int tex,
 	int col) {
-	int lump;
-	int ofs;
+	const uint8_t **columns = texturecolumns[tex];
 
-	col &= texturewidthmask[tex];
-	lump = texturecolumnlump[tex][col];
-	ofs  = texturecolumnofs[tex][col];
+	if(columns == NULL)
+		columns = R_CacheTexture(tex);
 
-	if(lump > 0)
-		return (const uint8_t *)W_LumpForId(lump)->data + ofs;
+	return columns[col & texturewidthmask[tex]];
+}
 
-	if(!texturecomposite[tex])
-		R_GenerateComposite(tex);
+//
+// R_GetMaskedColumn
+// Columns with posts for R_DrawMaskedColumn, the composite
+//  of solid walls is only used where patches overlap.
+//
+const uint8_t *
+R_GetMaskedColumn(int tex,
+	int col) {
+	col &= texturewidthmask[tex];
+
+	if(texturemaskedlump[tex][col] >= 0)
+		return (const uint8_t *)W_LumpForId(texturemaskedlump[tex][col])->data + texturemaskedofs[tex][col];
 
-	return texturecomposite[tex] + ofs;
+	return R_GetColumn(tex, col);
 }
 
 //
@@ -383,6 +516,7 @@ R_InitTextures(void) {
 	const char *name_p;
 
 	int *patchlookup;
+	const lumpId_t *patchlumps;
 
 	int totalwidth;
 	int nummappatches;
@@ -394,8 +528,7 @@ R_InitTextures(void) {
 
 	const int *directory;
 
-	int temp1;
-	int temp2;
+	size_t count;
 	int temp3;
 
 	// Load the patch names from pnames.lmp.
@@ -404,10 +537,17 @@ R_InitTextures(void) {
 	nummappatches = LONG(*(uint32_t *)names);
 	name_p        = names + 4;
 	patchlookup   = alloca(nummappatches * sizeof(*patchlookup));
+	patchlumps    = W_NamespaceIds(W_NAMESPACE_PATCHES, &count);
 
+	// Patches between markers first, so sprites
+	//  or flats of the same name are never used.
 	for(i = 0; i < nummappatches; i++) {
 		strncpy(name, name_p + i * 8, 8);
-		patchlookup[i] = W_FindIdForName(name);
+		j = W_FindNamespaceIndex(W_NAMESPACE_PATCHES, name);
+		if(j != -1)
+			patchlookup[i] = patchlumps[j];
+		else
+			patchlookup[i] = W_FindIdForName(name);
 	}
 
 	// Load the map texture definitions from textures.lmp.
@@ -435,7 +575,10 @@ R_InitTextures(void) {
 	textures             = Z_Malloc(numtextures * sizeof(*textures), PU_STATIC, 0);
 	texturecolumnlump    = Z_Malloc(numtextures * sizeof(*texturecolumnlump), PU_STATIC, 0);
 	texturecolumnofs     = Z_Malloc(numtextures * sizeof(*texturecolumnofs), PU_STATIC, 0);
+	texturemaskedlump    = Z_Malloc(numtextures * sizeof(*texturemaskedlump), PU_STATIC, 0);
+	texturemaskedofs     = Z_Malloc(numtextures * sizeof(*texturemaskedofs), PU_STATIC, 0);
 	texturecomposite     = Z_Malloc(numtextures * sizeof(*texturecomposite), PU_STATIC, 0);
+	texturecolumns       = Z_Malloc(numtextures * sizeof(*texturecolumns), PU_STATIC, 0);
 	texturecompositesize = Z_Malloc(numtextures * sizeof(*texturecompositesize), PU_STATIC, 0);
 	texturewidthmask     = Z_Malloc(numtextures * sizeof(*texturewidthmask), PU_STATIC, 0);
 	textureheight        = Z_Malloc(numtextures * sizeof(*textureheight), PU_STATIC, 0);
@@ -443,9 +586,8 @@ R_InitTextures(void) {
 	totalwidth = 0;
 
 	//	Really complex printing shit...
-	temp1 = W_FindIdForName("S_START"); // P_???????
-	temp2 = W_FindIdForName("S_END") - 1;
-	temp3 = ((temp2 - temp1 + 63) / 64) + ((numtextures + 63) / 64);
+	W_NamespaceIds(W_NAMESPACE_SPRITES, &count);
+	temp3 = ((count + 63) / 64) + ((numtextures + 63) / 64);
 	printf("[");
 	for(i = 0; i < temp3; i++)
 		printf(" ");
@@ -496,6 +638,8 @@ R_InitTextures(void) {
 		}
 		texturecolumnlump[i] = Z_Malloc(texture->width * sizeof(**texturecolumnlump), PU_STATIC, 0);
 		texturecolumnofs[i]  = Z_Malloc(texture->width * sizeof(**texturecolumnofs), PU_STATIC, 0);
+		texturemaskedlump[i] = Z_Malloc(texture->width * sizeof(**texturemaskedlump), PU_STATIC, 0);
+		texturemaskedofs[i]  = Z_Malloc(texture->width * sizeof(**texturemaskedofs), PU_STATIC, 0);
 
 		j = 1;
 		while(j * 2 <= texture->width)
@@ -523,11 +667,11 @@ R_InitTextures(void) {
 //
 void
 R_InitFlats(void) {
+	size_t count;
 	int i;
 
-	firstflat = W_GetIdForName("F_START") + 1;
-	lastflat  = W_GetIdForName("F_END") - 1;
-	numflats  = lastflat - firstflat + 1;
+	flatlumps = W_NamespaceIds(W_NAMESPACE_FLATS, &count);
+	numflats  = count;
 
 	// Create translation table for global animation.
 	flattranslation = Z_Malloc((numflats + 1) * 4, PU_STATIC, 0);
@@ -545,12 +689,11 @@ R_InitFlats(void) {
 void
 R_InitSpriteLumps(void) {
 	int i;
+	size_t count;
 	const patch_t *patch;
 
-	firstspritelump = W_GetIdForName("S_START") + 1;
-	lastspritelump  = W_GetIdForName("S_END") - 1;
-
-	numspritelumps  = lastspritelump - firstspritelump + 1;
+	spritelumps     = W_NamespaceIds(W_NAMESPACE_SPRITES, &count);
+	numspritelumps  = count;
 	spritewidth     = Z_Malloc(numspritelumps * 4, PU_STATIC, 0);
 	spriteoffset    = Z_Malloc(numspritelumps * 4, PU_STATIC, 0);
 	spritetopoffset = Z_Malloc(numspritelumps * 4, PU_STATIC, 0);
@@ -559,7 +702,7 @@ R_InitSpriteLumps(void) {
 		if(!(i & 63))
 			printf(".");
 
-		patch              = W_LumpForId(firstspritelump + i)->data;
+		patch              = W_LumpForId(spritelumps[i])->data;
 		spritewidth[i]     = SHORT(patch->width) << FRACBITS;
 		spriteoffset[i]    = SHORT(patch->leftoffset) << FRACBITS;
 		spritetopoffset[i] = SHORT(patch->topoffset) << FRACBITS;
@@ -598,16 +741,16 @@ R_InitData(void) {
 //
 int
 R_FlatNumForName(const char *name) {
-	const lumpId_t id = W_FindIdForName(name);
+	const int i = W_FindNamespaceIndex(W_NAMESPACE_FLATS, name);
 	char namet[9];
 
-	if(id == -1) {
+	if(i == -1) {
 		namet[8] = 0;
 		memcpy(namet, name, 8);
 		I_Error("R_FlatNumForName: %s not found", namet);
 	}
 
-	return id - firstflat;
+	return i;
 }
 
 //
@@ -651,34 +794,31 @@ R_TextureNumForName(const char *name) {
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
+// Lumps are mapped, their pages are read in the background
+//  while textures are composited.
 //
-/* NB: Replacing WAD I/O by file mapping deprecates the need for level pre-caching
-int flatmemory;
-int texturememory;
-int spritememory;
-*/
-
 void
 R_PrecacheLevel(void) {
-/*
-	char *flatpresent;
-	char *texturepresent;
-	char *spritepresent;
+	byte *flatpresent;
+	byte *texturepresent;
+	byte *spritepresent;
+	lumpId_t *lumps;
+	int numlumps;
+	int maxlumps;
+	int mark;
 
 	int i;
 	int j;
 	int k;
-	int lump;
 
 	texture_t *texture;
 	thinker_t *th;
 	spriteframe_t *sf;
 
-	if(demoplayback)
-		return;
+	mark = Z_ScratchMark(&framescratch);
 
-	// Precache flats.
-	flatpresent = alloca(numflats);
+	// Flats of every sector.
+	flatpresent = Z_ScratchAlloc(&framescratch, numflats);
 	memset(flatpresent, 0, numflats);
 
 	for(i = 0; i < numsectors; i++) {
@@ -686,18 +826,8 @@ R_PrecacheLevel(void) {
 		flatpresent[sectors[i].ceilingpic] = 1;
 	}
 
-	flatmemory = 0;
-
-	for(i = 0; i < numflats; i++) {
-		if(flatpresent[i]) {
-			lump = firstflat + i;
-			flatmemory += lumpinfo[lump].size;
-			W_CacheLumpNum(lump, PU_CACHE);
-		}
-	}
-
-	// Precache textures.
-	texturepresent = alloca(numtextures);
+	// Textures of every side.
+	texturepresent = Z_ScratchAlloc(&framescratch, numtextures);
 	memset(texturepresent, 0, numtextures);
 
 	for(i = 0; i < numsides; i++) {
@@ -714,42 +844,57 @@ R_PrecacheLevel(void) {
 	//  name.
 	texturepresent[skytexture] = 1;
 
-	texturememory = 0;
+	// Sprites of every spawned thing.
+	spritepresent = Z_ScratchAlloc(&framescratch, numsprites);
+	memset(spritepresent, 0, numsprites);
+
+	for(th = thinkercap.next; th != &thinkercap; th = th->next) {
+		if(th->function.acp1 == (actionf_p1)P_MobjThinker)
+			spritepresent[((mobj_t *)th)->sprite] = 1;
+	}
+
+	maxlumps = numflats;
 	for(i = 0; i < numtextures; i++) {
-		if(!texturepresent[i])
-			continue;
+		if(texturepresent[i])
+			maxlumps += textures[i]->patchcount;
+	}
+	for(i = 0; i < numsprites; i++) {
+		if(spritepresent[i])
+			maxlumps += sprites[i].numframes * 8;
+	}
 
-		texture = textures[i];
+	lumps    = Z_Malloc(maxlumps * sizeof(*lumps), PU_STATIC, 0);
+	numlumps = 0;
 
-		for(j = 0; j < texture->patchcount; j++) {
-			lump = texture->patches[j].patch;
-			texturememory += lumpinfo[lump].size;
-			W_CacheLumpNum(lump, PU_CACHE);
-		}
+	for(i = 0; i < numflats; i++) {
+		if(flatpresent[i])
+			lumps[numlumps++] = flatlumps[i];
 	}
 
-	// Precache sprites.
-	spritepresent = alloca(numsprites);
-	memset(spritepresent, 0, numsprites);
+	for(i = 0; i < numtextures; i++) {
+		if(!texturepresent[i])
+			continue;
 
-	for(th = thinkercap.next; th != &thinkercap; th = th->next) {
-		if(th->function.acp1 == (actionf_p1)P_MobjThinker)
-			spritepresent[((mobj_t *)th)->sprite] = 1;
+		texture = textures[i];
+		for(j = 0; j < texture->patchcount; j++)
+			lumps[numlumps++] = texture->patches[j].patch;
 	}
 
-	spritememory = 0;
 	for(i = 0; i < numsprites; i++) {
 		if(!spritepresent[i])
 			continue;
 
 		for(j = 0; j < sprites[i].numframes; j++) {
 			sf = &sprites[i].spriteframes[j];
-			for(k = 0; k < 8; k++) {
-				lump = firstspritelump + sf->lump[k];
-				spritememory += lumpinfo[lump].size;
-				W_CacheLumpNum(lump, PU_CACHE);
-			}
+			for(k = 0; k < (sf->rotate ? 8 : 1); k++)
+				lumps[numlumps++] = spritelumps[sf->lump[k]];
 		}
 	}
-*/
+
+	W_Prefetch(lumps, numlumps);
+	Z_Free(lumps);
+
+	R_PrecacheTextures(texturepresent);
+
+	Z_ScratchRelease(&framescratch, mark);
 }
@@ -35,6 +35,11 @@ const uint8_t *
 R_GetColumn(int tex,
 	int col);
 
+// Retrieve column data with its posts, for masked drawing.
+const uint8_t *
+R_GetMaskedColumn(int tex,
+	int col);
+
 // I/O, setting up the stuff.
 void
 R_InitData(void);
@@ -20,10 +20,13 @@
 //-----------------------------------------------------------------------------
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "doomdef.h"
 
 #include "i_system.h"
+#include "m_argv.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -35,6 +38,11 @@
 // State.
 #include "doomstat.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define R_DRAW_X86
+#endif
+
 // ?
 #define MAXWIDTH 1120
 #define MAXHEIGHT 832
@@ -77,6 +85,19 @@ int dc_yh;
 fixed_t dc_iscale;
 fixed_t dc_texturemid;
 
+// texture height in texels, for drawers that wrap
+int dc_texheight;
+
+// View border graphics, resolved on first use.
+static struct w_handle brdr_t  = W_HANDLE("brdr_t");
+static struct w_handle brdr_b  = W_HANDLE("brdr_b");
+static struct w_handle brdr_l  = W_HANDLE("brdr_l");
+static struct w_handle brdr_r  = W_HANDLE("brdr_r");
+static struct w_handle brdr_tl = W_HANDLE("brdr_tl");
+static struct w_handle brdr_tr = W_HANDLE("brdr_tr");
+static struct w_handle brdr_bl = W_HANDLE("brdr_bl");
+static struct w_handle brdr_br = W_HANDLE("brdr_br");
+
 // first pixel in a column (possibly virtual)
 const uint8_t *dc_source;
 
@@ -134,64 +155,6 @@ R_DrawColumn(void) {
 	} while(count--);
 }
 
-// UNUSED.
-// Loop unrolled.
-#if 0
-void R_DrawColumn (void) 
-{ 
-    int			count; 
-    byte*		source;
-    byte*		dest;
-    byte*		colormap;
-    
-    unsigned		frac;
-    unsigned		fracstep;
-    unsigned		fracstep2;
-    unsigned		fracstep3;
-    unsigned		fracstep4;	 
- 
-    count = dc_yh - dc_yl + 1; 
-
-    source = dc_source;
-    colormap = dc_colormap;		 
-    dest = ylookup[dc_yl] + columnofs[dc_x];  
-	 
-    fracstep = dc_iscale<<9; 
-    frac = (dc_texturemid + (dc_yl-centery)*dc_iscale)<<9; 
- 
-    fracstep2 = fracstep+fracstep;
-    fracstep3 = fracstep2+fracstep;
-    fracstep4 = fracstep3+fracstep;
-	
-    while (count >= 8) 
-    { 
-	dest[0] = colormap[source[frac>>25]]; 
-	dest[SCREENWIDTH] = colormap[source[(frac+fracstep)>>25]]; 
-	dest[SCREENWIDTH*2] = colormap[source[(frac+fracstep2)>>25]]; 
-	dest[SCREENWIDTH*3] = colormap[source[(frac+fracstep3)>>25]];
-	
-	frac += fracstep4; 
-
-	dest[SCREENWIDTH*4] = colormap[source[frac>>25]]; 
-	dest[SCREENWIDTH*5] = colormap[source[(frac+fracstep)>>25]]; 
-	dest[SCREENWIDTH*6] = colormap[source[(frac+fracstep2)>>25]]; 
-	dest[SCREENWIDTH*7] = colormap[source[(frac+fracstep3)>>25]]; 
-
-	frac += fracstep4; 
-	dest += SCREENWIDTH*8; 
-	count -= 8;
-    } 
-	
-    while (count > 0)
-    { 
-	*dest = colormap[source[frac>>25]]; 
-	dest += SCREENWIDTH; 
-	frac += fracstep; 
-	count--;
-    } 
-}
-#endif
-
 void
 R_DrawColumnLow(void) {
 	int count;
@@ -563,78 +526,6 @@ R_DrawSpan(void) {
 	} while(count--);
 }
 
-// UNUSED.
-// Loop unrolled by 4.
-#if 0
-void R_DrawSpan (void) 
-{ 
-    unsigned	position, step;
-
-    byte*	source;
-    byte*	colormap;
-    byte*	dest;
-    
-    unsigned	count;
-    usingned	spot; 
-    unsigned	value;
-    unsigned	temp;
-    unsigned	xtemp;
-    unsigned	ytemp;
-		
-    position = ((ds_xfrac<<10)&0xffff0000) | ((ds_yfrac>>6)&0xffff);
-    step = ((ds_xstep<<10)&0xffff0000) | ((ds_ystep>>6)&0xffff);
-		
-    source = ds_source;
-    colormap = ds_colormap;
-    dest = ylookup[ds_y] + columnofs[ds_x1];	 
-    count = ds_x2 - ds_x1 + 1; 
-	
-    while (count >= 4) 
-    { 
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[0] = colormap[source[spot]]; 
-
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[1] = colormap[source[spot]];
-	
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[2] = colormap[source[spot]];
-	
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	dest[3] = colormap[source[spot]]; 
-		
-	count -= 4;
-	dest += 4;
-    } 
-    while (count > 0) 
-    { 
-	ytemp = position>>4;
-	ytemp = ytemp & 4032;
-	xtemp = position>>26;
-	spot = xtemp | ytemp;
-	position += step;
-	*dest++ = colormap[source[spot]]; 
-	count--;
-    } 
-}
-#endif
-
 //
 // Again..
 //
@@ -683,35 +574,1145 @@ R_DrawSpanLow(void) {
 }
 
 //
-// R_InitBuffer
-// Creats lookup tables that avoid
-//  multiplies and other hazzles
-//  for getting the framebuffer address
-//  of a pixel to draw.
+// Unrolled and vectorized drawers.
+// Same mapping as R_DrawColumn and R_DrawSpan,
+//  the output is bit-identical, but several texture
+//  coordinates are computed per iteration.
+// The fixed point fracs are stepped as unsigned,
+//  only the masked low bits are used so wraparound
+//  gives the same texels as the reference loops.
+//
+
+//
+// R_DrawColumnUnrolled
+// Portable fallback, four pixels per iteration.
 //
 void
-R_InitBuffer(int width,
-	int height) {
-	int i;
+R_DrawColumnUnrolled(void) {
+	int count;
+	byte *dest;
+	const uint8_t *source;
+	const lighttable_t *colormap;
+	unsigned frac;
+	unsigned fracstep;
 
-	// Handle resize,
-	//  e.g. smaller view windows
-	//  with border and/or status bar.
-	viewwindowx = (SCREENWIDTH - width) >> 1;
+	count = dc_yh - dc_yl + 1;
 
-	// Column offset. For windows.
-	for(i = 0; i < width; i++)
-		columnofs[i] = viewwindowx + i;
+	if(count <= 0)
+		return;
 
-	// Samw with base row offset.
-	if(width == SCREENWIDTH)
-		viewwindowy = 0;
-	else
-		viewwindowy = (SCREENHEIGHT - SBARHEIGHT - height) >> 1;
+#ifdef RANGECHECK
+	if((unsigned)dc_x >= SCREENWIDTH
+		|| dc_yl < 0
+		|| dc_yh >= SCREENHEIGHT)
+		I_Error("R_DrawColumnUnrolled: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
 
-	// Preclaculate all row offsets.
-	for(i = 0; i < height; i++)
-		ylookup[i] = screens[0] + (i + viewwindowy) * SCREENWIDTH;
+	source   = dc_source;
+	colormap = dc_colormap;
+	dest     = ylookup[dc_yl] + columnofs[dc_x];
+
+	fracstep = dc_iscale;
+	frac     = (unsigned)dc_texturemid + (unsigned)(dc_yl - centery) * fracstep;
+
+	while(count >= 4) {
+		dest[0]               = colormap[source[(frac >> FRACBITS) & 127]];
+		dest[SCREENWIDTH]     = colormap[source[((frac + fracstep) >> FRACBITS) & 127]];
+		dest[SCREENWIDTH * 2] = colormap[source[((frac + fracstep * 2) >> FRACBITS) & 127]];
+		dest[SCREENWIDTH * 3] = colormap[source[((frac + fracstep * 3) >> FRACBITS) & 127]];
+
+		frac += fracstep * 4;
+		dest += SCREENWIDTH * 4;
+		count -= 4;
+	}
+
+	while(count--) {
+		*dest = colormap[source[(frac >> FRACBITS) & 127]];
+		dest += SCREENWIDTH;
+		frac += fracstep;
+	}
+}
+
+//
+// R_DrawSpanUnrolled
+// Portable fallback, four pixels per iteration.
+//
+void
+R_DrawSpanUnrolled(void) {
+	unsigned xfrac;
+	unsigned yfrac;
+	unsigned xstep;
+	unsigned ystep;
+	const uint8_t *source;
+	const lighttable_t *colormap;
+	byte *dest;
+	int count;
+
+#ifdef RANGECHECK
+	if(ds_x2 < ds_x1
+		|| ds_x1 < 0
+		|| ds_x2 >= SCREENWIDTH
+		|| (unsigned)ds_y > SCREENHEIGHT) {
+		I_Error("R_DrawSpanUnrolled: %i to %i at %i",
+			ds_x1,
+			ds_x2,
+			ds_y);
+	}
+#endif
+
+	xfrac    = ds_xfrac;
+	yfrac    = ds_yfrac;
+	xstep    = ds_xstep;
+	ystep    = ds_ystep;
+	source   = ds_source;
+	colormap = ds_colormap;
+	dest     = ylookup[ds_y] + columnofs[ds_x1];
+	count    = ds_x2 - ds_x1 + 1;
+
+#define SPOT(x, y) ((((y) >> (16 - 6)) & (63 * 64)) + (((x) >> 16) & 63))
+	while(count >= 4) {
+		dest[0] = colormap[source[SPOT(xfrac, yfrac)]];
+		dest[1] = colormap[source[SPOT(xfrac + xstep, yfrac + ystep)]];
+		dest[2] = colormap[source[SPOT(xfrac + xstep * 2, yfrac + ystep * 2)]];
+		dest[3] = colormap[source[SPOT(xfrac + xstep * 3, yfrac + ystep * 3)]];
+
+		xfrac += xstep * 4;
+		yfrac += ystep * 4;
+		dest += 4;
+		count -= 4;
+	}
+
+	while(count--) {
+		*dest++ = colormap[source[SPOT(xfrac, yfrac)]];
+		xfrac += xstep;
+		yfrac += ystep;
+	}
+#undef SPOT
+}
+
+//
+// R_DrawSpanPrelit
+// The flat in ds_source is already lit,
+//  see R_MapPlane, no colormap lookup.
+//
+void
+R_DrawSpanPrelit(void) {
+	unsigned xfrac;
+	unsigned yfrac;
+	unsigned xstep;
+	unsigned ystep;
+	const uint8_t *source;
+	byte *dest;
+	int count;
+
+#ifdef RANGECHECK
+	if(ds_x2 < ds_x1
+		|| ds_x1 < 0
+		|| ds_x2 >= SCREENWIDTH
+		|| (unsigned)ds_y > SCREENHEIGHT) {
+		I_Error("R_DrawSpanPrelit: %i to %i at %i",
+			ds_x1,
+			ds_x2,
+			ds_y);
+	}
+#endif
+
+	xfrac  = ds_xfrac;
+	yfrac  = ds_yfrac;
+	xstep  = ds_xstep;
+	ystep  = ds_ystep;
+	source = ds_source;
+	dest   = ylookup[ds_y] + columnofs[ds_x1];
+	count  = ds_x2 - ds_x1 + 1;
+
+#define SPOT(x, y) ((((y) >> (16 - 6)) & (63 * 64)) + (((x) >> 16) & 63))
+	while(count >= 4) {
+		dest[0] = source[SPOT(xfrac, yfrac)];
+		dest[1] = source[SPOT(xfrac + xstep, yfrac + ystep)];
+		dest[2] = source[SPOT(xfrac + xstep * 2, yfrac + ystep * 2)];
+		dest[3] = source[SPOT(xfrac + xstep * 3, yfrac + ystep * 3)];
+
+		xfrac += xstep * 4;
+		yfrac += ystep * 4;
+		dest += 4;
+		count -= 4;
+	}
+
+	while(count--) {
+		*dest++ = source[SPOT(xfrac, yfrac)];
+		xfrac += xstep;
+		yfrac += ystep;
+	}
+#undef SPOT
+}
+
+//
+// R_DrawSpanPrelitLow
+// Blocky mode of R_DrawSpanPrelit.
+//
+void
+R_DrawSpanPrelitLow(void) {
+	fixed_t xfrac;
+	fixed_t yfrac;
+	byte *dest;
+	int count;
+	int spot;
+
+#ifdef RANGECHECK
+	if(ds_x2 < ds_x1
+		|| ds_x1 < 0
+		|| ds_x2 >= SCREENWIDTH
+		|| (unsigned)ds_y > SCREENHEIGHT) {
+		I_Error("R_DrawSpanPrelitLow: %i to %i at %i",
+			ds_x1,
+			ds_x2,
+			ds_y);
+	}
+#endif
+
+	xfrac = ds_xfrac;
+	yfrac = ds_yfrac;
+
+	ds_x1 <<= 1;
+	ds_x2 <<= 1;
+
+	dest = ylookup[ds_y] + columnofs[ds_x1];
+
+	count = ds_x2 - ds_x1;
+	do {
+		spot    = ((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63);
+		*dest++ = ds_source[spot];
+		*dest++ = ds_source[spot];
+
+		xfrac += ds_xstep;
+		yfrac += ds_ystep;
+
+	} while(count--);
+}
+
+//
+// Deferred lighting.
+// With -deferred, the view is drawn into a separate
+//  buffer holding texel indices, with the colormap
+//  number of each pixel LIGHTOFFSET bytes after it.
+// R_ResolveLight then applies the colormaps
+//  to the whole view at once.
+// Fuzz can't wait, it reads its neighbours resolved
+//  and stores them with colormap #6.
+// Translation is applied to the stored index.
+//
+#define LIGHTOFFSET (SCREENWIDTH * SCREENHEIGHT)
+#define LIGHTCODE(colormap) (((colormap)-colormaps) >> 8)
+
+boolean deferredlight;
+static byte *deferredbuffer;
+static void (*resolvefunc)(byte *dest, const byte *source, int count);
+
+void
+R_DrawColumnDeferred(void) {
+	int count;
+	byte *dest;
+	byte light;
+	fixed_t frac;
+	fixed_t fracstep;
+
+	count = dc_yh - dc_yl;
+	if(count < 0)
+		return;
+
+#ifdef RANGECHECK
+	if((unsigned)dc_x >= SCREENWIDTH
+		|| dc_yl < 0
+		|| dc_yh >= SCREENHEIGHT)
+		I_Error("R_DrawColumnDeferred: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+	dest  = ylookup[dc_yl] + columnofs[dc_x];
+	light = LIGHTCODE(dc_colormap);
+
+	fracstep = dc_iscale;
+	frac     = dc_texturemid + (dc_yl - centery) * fracstep;
+
+	do {
+		dest[0]           = dc_source[(frac >> FRACBITS) & 127];
+		dest[LIGHTOFFSET] = light;
+
+		dest += SCREENWIDTH;
+		frac += fracstep;
+	} while(count--);
+}
+
+void
+R_DrawColumnDeferredLow(void) {
+	int count;
+	byte *dest;
+	byte light;
+	fixed_t frac;
+	fixed_t fracstep;
+
+	count = dc_yh - dc_yl;
+	if(count < 0)
+		return;
+
+#ifdef RANGECHECK
+	if((unsigned)dc_x >= SCREENWIDTH
+		|| dc_yl < 0
+		|| dc_yh >= SCREENHEIGHT)
+		I_Error("R_DrawColumnDeferredLow: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+	// Blocky mode, need to multiply by 2.
+	dc_x <<= 1;
+
+	dest  = ylookup[dc_yl] + columnofs[dc_x];
+	light = LIGHTCODE(dc_colormap);
+
+	fracstep = dc_iscale;
+	frac     = dc_texturemid + (dc_yl - centery) * fracstep;
+
+	do {
+		dest[0] = dest[1] = dc_source[(frac >> FRACBITS) & 127];
+		dest[LIGHTOFFSET] = dest[LIGHTOFFSET + 1] = light;
+
+		dest += SCREENWIDTH;
+		frac += fracstep;
+	} while(count--);
+}
+
+void
+R_DrawFuzzColumnDeferred(void) {
+	int count;
+	byte *dest;
+	const byte *fuzz;
+
+	// Adjust borders. Low...
+	if(!dc_yl)
+		dc_yl = 1;
+
+	// .. and high.
+	if(dc_yh == viewheight - 1)
+		dc_yh = viewheight - 2;
+
+	count = dc_yh - dc_yl;
+	if(count < 0)
+		return;
+
+#ifdef RANGECHECK
+	if((unsigned)dc_x >= SCREENWIDTH
+		|| dc_yl < 0 || dc_yh >= SCREENHEIGHT) {
+		I_Error("R_DrawFuzzColumnDeferred: %i to %i at %i",
+			dc_yl,
+			dc_yh,
+			dc_x);
+	}
+#endif
+
+	dest = ylookup[dc_yl] + columnofs[dc_x];
+
+	do {
+		fuzz              = dest + fuzzoffset[fuzzpos];
+		dest[0]           = colormaps[fuzz[LIGHTOFFSET] * 256 + fuzz[0]];
+		dest[LIGHTOFFSET] = 6;
+
+		// Clamp table lookup index.
+		if(++fuzzpos == FUZZTABLE)
+			fuzzpos = 0;
+
+		dest += SCREENWIDTH;
+	} while(count--);
+}
+
+void
+R_DrawTranslatedColumnDeferred(void) {
+	int count;
+	byte *dest;
+	byte light;
+	fixed_t frac;
+	fixed_t fracstep;
+
+	count = dc_yh - dc_yl;
+	if(count < 0)
+		return;
+
+#ifdef RANGECHECK
+	if((unsigned)dc_x >= SCREENWIDTH
+		|| dc_yl < 0
+		|| dc_yh >= SCREENHEIGHT) {
+		I_Error("R_DrawTranslatedColumnDeferred: %i to %i at %i",
+			dc_yl,
+			dc_yh,
+			dc_x);
+	}
+#endif
+
+	dest  = ylookup[dc_yl] + columnofs[dc_x];
+	light = LIGHTCODE(dc_colormap);
+
+	fracstep = dc_iscale;
+	frac     = dc_texturemid + (dc_yl - centery) * fracstep;
+
+	do {
+		dest[0]           = dc_translation[dc_source[frac >> FRACBITS]];
+		dest[LIGHTOFFSET] = light;
+
+		dest += SCREENWIDTH;
+		frac += fracstep;
+	} while(count--);
+}
+
+void
+R_DrawSpanDeferred(void) {
+	unsigned xfrac;
+	unsigned yfrac;
+	byte *dest;
+	byte light;
+	int count;
+
+#ifdef RANGECHECK
+	if(ds_x2 < ds_x1
+		|| ds_x1 < 0
+		|| ds_x2 >= SCREENWIDTH
+		|| (unsigned)ds_y > SCREENHEIGHT) {
+		I_Error("R_DrawSpanDeferred: %i to %i at %i",
+			ds_x1,
+			ds_x2,
+			ds_y);
+	}
+#endif
+
+	xfrac = ds_xfrac;
+	yfrac = ds_yfrac;
+	dest  = ylookup[ds_y] + columnofs[ds_x1];
+	light = LIGHTCODE(ds_colormap);
+	count = ds_x2 - ds_x1 + 1;
+
+	// The whole span shares a colormap.
+	memset(dest + LIGHTOFFSET, light, count);
+
+	while(count--) {
+		*dest++ = ds_source[((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63)];
+		xfrac += ds_xstep;
+		yfrac += ds_ystep;
+	}
+}
+
+void
+R_DrawSpanDeferredLow(void) {
+	fixed_t xfrac;
+	fixed_t yfrac;
+	byte *dest;
+	int count;
+	int spot;
+
+#ifdef RANGECHECK
+	if(ds_x2 < ds_x1
+		|| ds_x1 < 0
+		|| ds_x2 >= SCREENWIDTH
+		|| (unsigned)ds_y > SCREENHEIGHT) {
+		I_Error("R_DrawSpanDeferredLow: %i to %i at %i",
+			ds_x1,
+			ds_x2,
+			ds_y);
+	}
+#endif
+
+	xfrac = ds_xfrac;
+	yfrac = ds_yfrac;
+
+	ds_x1 <<= 1;
+	ds_x2 <<= 1;
+
+	dest  = ylookup[ds_y] + columnofs[ds_x1];
+	count = ds_x2 - ds_x1;
+
+	memset(dest + LIGHTOFFSET, LIGHTCODE(ds_colormap), (count + 1) * 2);
+
+	do {
+		spot    = ((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63);
+		*dest++ = ds_source[spot];
+		*dest++ = ds_source[spot];
+
+		xfrac += ds_xstep;
+		yfrac += ds_ystep;
+	} while(count--);
+}
+
+//
+// Columns of textures other than 128 high.
+// R_DrawColumn and friends wrap at 128 texels,
+//  these wrap at dc_texheight, with a mask for powers
+//  of two and a modulo otherwise. Columns which stay
+//  within the texture skip the wrapping altogether.
+// All are instances of R_DrawColumnWrap.
+//
+static inline __attribute__((always_inline)) void
+R_DrawColumnWrap(boolean low,
+	boolean deferred,
+	boolean modulo) {
+	int count;
+	byte *dest;
+	byte texel;
+	byte light;
+	int64_t start;
+	unsigned frac;
+	unsigned fracstep;
+	unsigned height;
+	unsigned mask;
+
+	count = dc_yh - dc_yl;
+	if(count < 0)
+		return;
+
+#ifdef RANGECHECK
+	if((unsigned)dc_x >= SCREENWIDTH
+		|| dc_yl < 0
+		|| dc_yh >= SCREENHEIGHT)
+		I_Error("R_DrawColumnWrap: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+	// Blocky mode, need to multiply by 2.
+	if(low)
+		dc_x <<= 1;
+
+	dest     = ylookup[dc_yl] + columnofs[dc_x];
+	light    = deferred ? LIGHTCODE(dc_colormap) : 0;
+	height   = (unsigned)dc_texheight << FRACBITS;
+	fracstep = dc_iscale;
+	start    = dc_texturemid + (int64_t)(dc_yl - centery) * (int64_t)fracstep;
+
+#define STORE(texel) \
+	do { \
+		if(deferred) { \
+			dest[0]           = (texel); \
+			dest[LIGHTOFFSET] = light; \
+			if(low) { \
+				dest[1]               = (texel); \
+				dest[LIGHTOFFSET + 1] = light; \
+			} \
+		} else { \
+			dest[0] = dc_colormap[(texel)]; \
+			if(low) \
+				dest[1] = dest[0]; \
+		} \
+		dest += SCREENWIDTH; \
+	} while(0)
+
+	if(start >= 0 && start + (int64_t)count * (int64_t)fracstep < height) {
+		// No wrap.
+		frac = start;
+		do {
+			texel = dc_source[frac >> FRACBITS];
+			STORE(texel);
+			frac += fracstep;
+		} while(count--);
+	} else if(modulo) {
+		frac = (start % height + height) % height;
+		fracstep %= height;
+		do {
+			texel = dc_source[frac >> FRACBITS];
+			STORE(texel);
+			frac += fracstep;
+			if(frac >= height)
+				frac -= height;
+		} while(count--);
+	} else {
+		frac = start;
+		mask = dc_texheight - 1;
+		do {
+			texel = dc_source[(frac >> FRACBITS) & mask];
+			STORE(texel);
+			frac += fracstep;
+		} while(count--);
+	}
+
+#undef STORE
+}
+
+void
+R_DrawColumnPow2(void) {
+	R_DrawColumnWrap(false, false, false);
+}
+
+void
+R_DrawColumnPow2Low(void) {
+	R_DrawColumnWrap(true, false, false);
+}
+
+void
+R_DrawColumnPow2Deferred(void) {
+	R_DrawColumnWrap(false, true, false);
+}
+
+void
+R_DrawColumnPow2DeferredLow(void) {
+	R_DrawColumnWrap(true, true, false);
+}
+
+void
+R_DrawColumnModulo(void) {
+	R_DrawColumnWrap(false, false, true);
+}
+
+void
+R_DrawColumnModuloLow(void) {
+	R_DrawColumnWrap(true, false, true);
+}
+
+void
+R_DrawColumnModuloDeferred(void) {
+	R_DrawColumnWrap(false, true, true);
+}
+
+void
+R_DrawColumnModuloDeferredLow(void) {
+	R_DrawColumnWrap(true, true, true);
+}
+
+//
+// R_ResolveRow
+// Texel indices and colormap numbers to colors.
+//
+static void
+R_ResolveRow(byte *dest,
+	const byte *source,
+	int count) {
+	while(count--) {
+		*dest++ = colormaps[source[LIGHTOFFSET] << 8 | source[0]];
+		source++;
+	}
+}
+
+#ifdef R_DRAW_X86
+
+//
+// R_DrawColumnSSE2
+// Four fracs stepped at once, texels
+//  and colormap fetched from the lanes.
+//
+__attribute__((target("sse2"))) static void
+R_DrawColumnSSE2(void) {
+	int count;
+	byte *dest;
+	const uint8_t *source;
+	const lighttable_t *colormap;
+	unsigned frac;
+	unsigned fracstep;
+	__m128i fracs;
+	__m128i fracstep4;
+	__m128i mask;
+	union {
+		__m128i v;
+		uint32_t i[4];
+	} spots;
+
+	count = dc_yh - dc_yl + 1;
+
+	if(count <= 0)
+		return;
+
+#ifdef RANGECHECK
+	if((unsigned)dc_x >= SCREENWIDTH
+		|| dc_yl < 0
+		|| dc_yh >= SCREENHEIGHT)
+		I_Error("R_DrawColumnSSE2: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+	source   = dc_source;
+	colormap = dc_colormap;
+	dest     = ylookup[dc_yl] + columnofs[dc_x];
+
+	fracstep = dc_iscale;
+	frac     = (unsigned)dc_texturemid + (unsigned)(dc_yl - centery) * fracstep;
+
+	fracs     = _mm_setr_epi32(frac, frac + fracstep, frac + fracstep * 2, frac + fracstep * 3);
+	fracstep4 = _mm_set1_epi32(fracstep * 4);
+	mask      = _mm_set1_epi32(127);
+
+	while(count >= 4) {
+		spots.v = _mm_and_si128(_mm_srli_epi32(fracs, FRACBITS), mask);
+		fracs   = _mm_add_epi32(fracs, fracstep4);
+
+		dest[0]               = colormap[source[spots.i[0]]];
+		dest[SCREENWIDTH]     = colormap[source[spots.i[1]]];
+		dest[SCREENWIDTH * 2] = colormap[source[spots.i[2]]];
+		dest[SCREENWIDTH * 3] = colormap[source[spots.i[3]]];
+
+		frac += fracstep * 4;
+		dest += SCREENWIDTH * 4;
+		count -= 4;
+	}
+
+	while(count--) {
+		*dest = colormap[source[(frac >> FRACBITS) & 127]];
+		dest += SCREENWIDTH;
+		frac += fracstep;
+	}
+}
+
+//
+// R_DrawSpanSSE2
+// Four u,v pairs stepped and combined into
+//  flat offsets at once.
+//
+__attribute__((target("sse2"))) static void
+R_DrawSpanSSE2(void) {
+	unsigned xfrac;
+	unsigned yfrac;
+	unsigned xstep;
+	unsigned ystep;
+	const uint8_t *source;
+	const lighttable_t *colormap;
+	byte *dest;
+	int count;
+	__m128i xfracs;
+	__m128i yfracs;
+	__m128i xstep4;
+	__m128i ystep4;
+	__m128i xmask;
+	__m128i ymask;
+	union {
+		__m128i v;
+		uint32_t i[4];
+	} spots;
+
+#ifdef RANGECHECK
+	if(ds_x2 < ds_x1
+		|| ds_x1 < 0
+		|| ds_x2 >= SCREENWIDTH
+		|| (unsigned)ds_y > SCREENHEIGHT) {
+		I_Error("R_DrawSpanSSE2: %i to %i at %i",
+			ds_x1,
+			ds_x2,
+			ds_y);
+	}
+#endif
+
+	xfrac    = ds_xfrac;
+	yfrac    = ds_yfrac;
+	xstep    = ds_xstep;
+	ystep    = ds_ystep;
+	source   = ds_source;
+	colormap = ds_colormap;
+	dest     = ylookup[ds_y] + columnofs[ds_x1];
+	count    = ds_x2 - ds_x1 + 1;
+
+	xfracs = _mm_setr_epi32(xfrac, xfrac + xstep, xfrac + xstep * 2, xfrac + xstep * 3);
+	yfracs = _mm_setr_epi32(yfrac, yfrac + ystep, yfrac + ystep * 2, yfrac + ystep * 3);
+	xstep4 = _mm_set1_epi32(xstep * 4);
+	ystep4 = _mm_set1_epi32(ystep * 4);
+	xmask  = _mm_set1_epi32(63);
+	ymask  = _mm_set1_epi32(63 * 64);
+
+	while(count >= 4) {
+		spots.v = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(yfracs, 16 - 6), ymask),
+			_mm_and_si128(_mm_srli_epi32(xfracs, 16), xmask));
+		xfracs = _mm_add_epi32(xfracs, xstep4);
+		yfracs = _mm_add_epi32(yfracs, ystep4);
+
+		dest[0] = colormap[source[spots.i[0]]];
+		dest[1] = colormap[source[spots.i[1]]];
+		dest[2] = colormap[source[spots.i[2]]];
+		dest[3] = colormap[source[spots.i[3]]];
+
+		xfrac += xstep * 4;
+		yfrac += ystep * 4;
+		dest += 4;
+		count -= 4;
+	}
+
+	while(count--) {
+		*dest++ = colormap[source[((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63)]];
+		xfrac += xstep;
+		yfrac += ystep;
+	}
+}
+
+//
+// AVX2 gathers fetch dwords, so each byte lookup
+//  loads the dword ending on it and keeps the top byte.
+// Sources must have three readable bytes before them,
+//  which holds for lumps (past the WAD header)
+//  and zone blocks (past the block header).
+//
+#define GATHERBYTES(base, index) \
+	_mm256_srli_epi32(_mm256_i32gather_epi32((const int *)((base) - 3), (index), 1), 24)
+
+//
+// R_DrawColumnAVX2
+// Eight fracs stepped at once, texels
+//  and colormap gathered for all the lanes.
+//
+__attribute__((target("avx2"))) static void
+R_DrawColumnAVX2(void) {
+	int count;
+	byte *dest;
+	const uint8_t *source;
+	const lighttable_t *colormap;
+	unsigned frac;
+	unsigned fracstep;
+	__m256i fracs;
+	__m256i fracstep8;
+	__m256i mask;
+	union {
+		__m256i v;
+		uint32_t i[8];
+	} pixels;
+
+	count = dc_yh - dc_yl + 1;
+
+	if(count <= 0)
+		return;
+
+#ifdef RANGECHECK
+	if((unsigned)dc_x >= SCREENWIDTH
+		|| dc_yl < 0
+		|| dc_yh >= SCREENHEIGHT)
+		I_Error("R_DrawColumnAVX2: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+	source   = dc_source;
+	colormap = dc_colormap;
+	dest     = ylookup[dc_yl] + columnofs[dc_x];
+
+	fracstep = dc_iscale;
+	frac     = (unsigned)dc_texturemid + (unsigned)(dc_yl - centery) * fracstep;
+
+	fracs = _mm256_add_epi32(_mm256_set1_epi32(frac),
+		_mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(fracstep)));
+	fracstep8 = _mm256_set1_epi32(fracstep * 8);
+	mask      = _mm256_set1_epi32(127);
+
+	while(count >= 8) {
+		pixels.v = _mm256_and_si256(_mm256_srli_epi32(fracs, FRACBITS), mask);
+		pixels.v = GATHERBYTES(source, pixels.v);
+		pixels.v = GATHERBYTES(colormap, pixels.v);
+		fracs    = _mm256_add_epi32(fracs, fracstep8);
+
+		dest[0]               = pixels.i[0];
+		dest[SCREENWIDTH]     = pixels.i[1];
+		dest[SCREENWIDTH * 2] = pixels.i[2];
+		dest[SCREENWIDTH * 3] = pixels.i[3];
+		dest[SCREENWIDTH * 4] = pixels.i[4];
+		dest[SCREENWIDTH * 5] = pixels.i[5];
+		dest[SCREENWIDTH * 6] = pixels.i[6];
+		dest[SCREENWIDTH * 7] = pixels.i[7];
+
+		frac += fracstep * 8;
+		dest += SCREENWIDTH * 8;
+		count -= 8;
+	}
+
+	while(count--) {
+		*dest = colormap[source[(frac >> FRACBITS) & 127]];
+		dest += SCREENWIDTH;
+		frac += fracstep;
+	}
+}
+
+//
+// R_DrawSpanAVX2
+// Eight u,v pairs stepped at once, texels and colormap
+//  gathered, then packed down to eight bytes stored at once.
+//
+__attribute__((target("avx2"))) static void
+R_DrawSpanAVX2(void) {
+	unsigned xfrac;
+	unsigned yfrac;
+	unsigned xstep;
+	unsigned ystep;
+	const uint8_t *source;
+	const lighttable_t *colormap;
+	byte *dest;
+	int count;
+	__m256i lanes;
+	__m256i xfracs;
+	__m256i yfracs;
+	__m256i xstep8;
+	__m256i ystep8;
+	__m256i xmask;
+	__m256i ymask;
+	__m256i pack;
+	__m256i merge;
+	__m256i pixels;
+
+#ifdef RANGECHECK
+	if(ds_x2 < ds_x1
+		|| ds_x1 < 0
+		|| ds_x2 >= SCREENWIDTH
+		|| (unsigned)ds_y > SCREENHEIGHT) {
+		I_Error("R_DrawSpanAVX2: %i to %i at %i",
+			ds_x1,
+			ds_x2,
+			ds_y);
+	}
+#endif
+
+	xfrac    = ds_xfrac;
+	yfrac    = ds_yfrac;
+	xstep    = ds_xstep;
+	ystep    = ds_ystep;
+	source   = ds_source;
+	colormap = ds_colormap;
+	dest     = ylookup[ds_y] + columnofs[ds_x1];
+	count    = ds_x2 - ds_x1 + 1;
+
+	lanes  = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	xfracs = _mm256_add_epi32(_mm256_set1_epi32(xfrac), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(xstep)));
+	yfracs = _mm256_add_epi32(_mm256_set1_epi32(yfrac), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(ystep)));
+	xstep8 = _mm256_set1_epi32(xstep * 8);
+	ystep8 = _mm256_set1_epi32(ystep * 8);
+	xmask  = _mm256_set1_epi32(63);
+	ymask  = _mm256_set1_epi32(63 * 64);
+
+	// Low byte of each dword to the bottom of its
+	//  128 bits lane, then both lanes side by side.
+	pack = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	merge = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+	while(count >= 8) {
+		pixels = _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(yfracs, 16 - 6), ymask),
+			_mm256_and_si256(_mm256_srli_epi32(xfracs, 16), xmask));
+		pixels = GATHERBYTES(source, pixels);
+		pixels = GATHERBYTES(colormap, pixels);
+		pixels = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pixels, pack), merge);
+		_mm_storel_epi64((__m128i *)dest, _mm256_castsi256_si128(pixels));
+
+		xfracs = _mm256_add_epi32(xfracs, xstep8);
+		yfracs = _mm256_add_epi32(yfracs, ystep8);
+
+		xfrac += xstep * 8;
+		yfrac += ystep * 8;
+		dest += 8;
+		count -= 8;
+	}
+
+	while(count--) {
+		*dest++ = colormap[source[((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63)]];
+		xfrac += xstep;
+		yfrac += ystep;
+	}
+}
+
+//
+// R_DrawSpanPrelitAVX2
+// R_DrawSpanAVX2 without the colormap gather.
+//
+__attribute__((target("avx2"))) static void
+R_DrawSpanPrelitAVX2(void) {
+	unsigned xfrac;
+	unsigned yfrac;
+	unsigned xstep;
+	unsigned ystep;
+	const uint8_t *source;
+	byte *dest;
+	int count;
+	__m256i lanes;
+	__m256i xfracs;
+	__m256i yfracs;
+	__m256i xstep8;
+	__m256i ystep8;
+	__m256i xmask;
+	__m256i ymask;
+	__m256i pack;
+	__m256i merge;
+	__m256i pixels;
+
+#ifdef RANGECHECK
+	if(ds_x2 < ds_x1
+		|| ds_x1 < 0
+		|| ds_x2 >= SCREENWIDTH
+		|| (unsigned)ds_y > SCREENHEIGHT) {
+		I_Error("R_DrawSpanPrelitAVX2: %i to %i at %i",
+			ds_x1,
+			ds_x2,
+			ds_y);
+	}
+#endif
+
+	xfrac  = ds_xfrac;
+	yfrac  = ds_yfrac;
+	xstep  = ds_xstep;
+	ystep  = ds_ystep;
+	source = ds_source;
+	dest   = ylookup[ds_y] + columnofs[ds_x1];
+	count  = ds_x2 - ds_x1 + 1;
+
+	lanes  = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	xfracs = _mm256_add_epi32(_mm256_set1_epi32(xfrac), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(xstep)));
+	yfracs = _mm256_add_epi32(_mm256_set1_epi32(yfrac), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(ystep)));
+	xstep8 = _mm256_set1_epi32(xstep * 8);
+	ystep8 = _mm256_set1_epi32(ystep * 8);
+	xmask  = _mm256_set1_epi32(63);
+	ymask  = _mm256_set1_epi32(63 * 64);
+
+	pack = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	merge = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+	while(count >= 8) {
+		pixels = _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(yfracs, 16 - 6), ymask),
+			_mm256_and_si256(_mm256_srli_epi32(xfracs, 16), xmask));
+		pixels = GATHERBYTES(source, pixels);
+		pixels = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pixels, pack), merge);
+		_mm_storel_epi64((__m128i *)dest, _mm256_castsi256_si128(pixels));
+
+		xfracs = _mm256_add_epi32(xfracs, xstep8);
+		yfracs = _mm256_add_epi32(yfracs, ystep8);
+
+		xfrac += xstep * 8;
+		yfrac += ystep * 8;
+		dest += 8;
+		count -= 8;
+	}
+
+	while(count--) {
+		*dest++ = source[((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63)];
+		xfrac += xstep;
+		yfrac += ystep;
+	}
+}
+
+//
+// R_ResolveRowAVX2
+// Eight pixels per iteration, one gather into colormaps.
+//
+__attribute__((target("avx2"))) static void
+R_ResolveRowAVX2(byte *dest,
+	const byte *source,
+	int count) {
+	__m256i pack;
+	__m256i merge;
+	__m256i pixels;
+
+	pack = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	merge = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+	while(count >= 8) {
+		pixels = _mm256_or_si256(
+			_mm256_slli_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(source + LIGHTOFFSET))), 8),
+			_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)source)));
+		pixels = GATHERBYTES(colormaps, pixels);
+		pixels = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pixels, pack), merge);
+		_mm_storel_epi64((__m128i *)dest, _mm256_castsi256_si128(pixels));
+
+		source += 8;
+		dest += 8;
+		count -= 8;
+	}
+
+	R_ResolveRow(dest, source, count);
+}
+
+#undef GATHERBYTES
+
+#endif
+
+//
+// R_InitDrawers
+// Selects the fastest column and span drawers
+//  the running CPU supports, used by R_ExecuteSetViewSize
+//  for the high detail mode.
+// -nosimd keeps the reference drawers.
+//
+void (*drawcolumnfunc)(void);
+void (*drawspanfunc)(void);
+void (*drawprelitspanfunc)(void);
+
+void
+R_InitDrawers(void) {
+	const char *name;
+
+	drawcolumnfunc     = R_DrawColumnUnrolled;
+	drawspanfunc       = R_DrawSpanUnrolled;
+	drawprelitspanfunc = R_DrawSpanPrelit;
+	name               = "unrolled";
+
+#ifdef R_DRAW_X86
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx2")) {
+		drawcolumnfunc     = R_DrawColumnAVX2;
+		drawspanfunc       = R_DrawSpanAVX2;
+		drawprelitspanfunc = R_DrawSpanPrelitAVX2;
+		name               = "AVX2";
+	} else if(__builtin_cpu_supports("sse2")) {
+		drawcolumnfunc = R_DrawColumnSSE2;
+		drawspanfunc   = R_DrawSpanSSE2;
+		name           = "SSE2";
+	}
+#endif
+
+	resolvefunc = R_ResolveRow;
+#ifdef R_DRAW_X86
+	if(__builtin_cpu_supports("avx2"))
+		resolvefunc = R_ResolveRowAVX2;
+#endif
+
+	if(M_CheckParm("-deferred")) {
+		deferredbuffer = calloc(2, LIGHTOFFSET);
+		if(deferredbuffer == NULL)
+			I_Error("R_InitDrawers: Unable to allocate the deferred lighting buffer");
+		deferredlight = true;
+	}
+
+	if(M_CheckParm("-nosimd")) {
+		drawcolumnfunc = R_DrawColumn;
+		drawspanfunc   = R_DrawSpan;
+		name           = "reference";
+		resolvefunc    = R_ResolveRow;
+	}
+
+	printf(" (%s drawers%s)", name, deferredlight ? ", deferred lighting" : "");
+}
+
+//
+// R_InitBuffer
+// Creats lookup tables that avoid
+//  multiplies and other hazzles
+//  for getting the framebuffer address
+//  of a pixel to draw.
+//
+void
+R_InitBuffer(int width,
+	int height) {
+	int i;
+
+	// Handle resize,
+	//  e.g. smaller view windows
+	//  with border and/or status bar.
+	viewwindowx = (SCREENWIDTH - width) >> 1;
+
+	// Column offset. For windows.
+	for(i = 0; i < width; i++)
+		columnofs[i] = viewwindowx + i;
+
+	// Samw with base row offset.
+	if(width == SCREENWIDTH)
+		viewwindowy = 0;
+	else
+		viewwindowy = (SCREENHEIGHT - SBARHEIGHT - height) >> 1;
+
+	// Preclaculate all row offsets.
+	for(i = 0; i < height; i++)
+		ylookup[i] = (deferredlight ? deferredbuffer : screens[0]) + (i + viewwindowy) * SCREENWIDTH;
+}
+
+//
+// R_ResolveLight
+// Called by R_RenderPlayerView with deferred lighting,
+//  colors the view into screens[0].
+//
+void
+R_ResolveLight(void) {
+	int offset;
+	int y;
+
+	for(y = 0; y < viewheight; y++) {
+		offset = (y + viewwindowy) * SCREENWIDTH + viewwindowx;
+		resolvefunc(screens[0] + offset, deferredbuffer + offset, scaledviewwidth);
+	}
 }
 
 //
@@ -759,19 +1760,19 @@ R_FillBackScreen(void) {
 		}
 	}
 
-	patch = W_LumpForName("brdr_t")->data;
+	patch = W_LumpForHandle(&brdr_t)->data;
 
 	for(x = 0; x < scaledviewwidth; x += 8)
 		V_DrawPatch(viewwindowx + x, viewwindowy - 8, 1, patch);
-	patch = W_LumpForName("brdr_b")->data;
+	patch = W_LumpForHandle(&brdr_b)->data;
 
 	for(x = 0; x < scaledviewwidth; x += 8)
 		V_DrawPatch(viewwindowx + x, viewwindowy + viewheight, 1, patch);
-	patch = W_LumpForName("brdr_l")->data;
+	patch = W_LumpForHandle(&brdr_l)->data;
 
 	for(y = 0; y < viewheight; y += 8)
 		V_DrawPatch(viewwindowx - 8, viewwindowy + y, 1, patch);
-	patch = W_LumpForName("brdr_r")->data;
+	patch = W_LumpForHandle(&brdr_r)->data;
 
 	for(y = 0; y < viewheight; y += 8)
 		V_DrawPatch(viewwindowx + scaledviewwidth, viewwindowy + y, 1, patch);
@@ -780,22 +1781,22 @@ R_FillBackScreen(void) {
 	V_DrawPatch(viewwindowx - 8,
 		viewwindowy - 8,
 		1,
-		W_LumpForName("brdr_tl")->data);
+		W_LumpForHandle(&brdr_tl)->data);
 
 	V_DrawPatch(viewwindowx + scaledviewwidth,
 		viewwindowy - 8,
 		1,
-		W_LumpForName("brdr_tr")->data);
+		W_LumpForHandle(&brdr_tr)->data);
 
 	V_DrawPatch(viewwindowx - 8,
 		viewwindowy + viewheight,
 		1,
-		W_LumpForName("brdr_bl")->data);
+		W_LumpForHandle(&brdr_bl)->data);
 
 	V_DrawPatch(viewwindowx + scaledviewwidth,
 		viewwindowy + viewheight,
 		1,
-		W_LumpForName("brdr_br")->data);
+		W_LumpForHandle(&brdr_br)->data);
 }
 
 //
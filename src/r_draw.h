@@ -30,6 +30,7 @@ extern int dc_yl;
 extern int dc_yh;
 extern fixed_t dc_iscale;
 extern fixed_t dc_texturemid;
+extern int dc_texheight;
 
 // first pixel in a column
 extern const uint8_t *dc_source;
@@ -86,6 +87,69 @@ R_DrawSpan(void);
 void
 R_DrawSpanLow(void);
 
+// Bit-identical to R_DrawColumn/R_DrawSpan,
+//  four pixels per iteration.
+void
+R_DrawColumnUnrolled(void);
+void
+R_DrawSpanUnrolled(void);
+
+// Spans of a pre-lit flat, ds_colormap is ignored.
+void
+R_DrawSpanPrelit(void);
+void
+R_DrawSpanPrelitLow(void);
+
+// Fastest column/span drawers for the running CPU,
+//  selected by R_InitDrawers.
+extern void (*drawcolumnfunc)(void);
+extern void (*drawspanfunc)(void);
+extern void (*drawprelitspanfunc)(void);
+
+// Deferred lighting, set by -deferred.
+// Drawers store texel indices and colormap numbers,
+//  R_ResolveLight turns them into colors.
+extern boolean deferredlight;
+
+void
+R_DrawColumnDeferred(void);
+void
+R_DrawColumnDeferredLow(void);
+void
+R_DrawFuzzColumnDeferred(void);
+void
+R_DrawTranslatedColumnDeferred(void);
+void
+R_DrawSpanDeferred(void);
+void
+R_DrawSpanDeferredLow(void);
+
+void
+R_ResolveLight(void);
+
+// Columns wrapping at dc_texheight texels,
+//  for textures other than 128 high.
+// Pow2 masks, Modulo for any other height.
+void
+R_DrawColumnPow2(void);
+void
+R_DrawColumnPow2Low(void);
+void
+R_DrawColumnPow2Deferred(void);
+void
+R_DrawColumnPow2DeferredLow(void);
+void
+R_DrawColumnModulo(void);
+void
+R_DrawColumnModuloLow(void);
+void
+R_DrawColumnModuloDeferred(void);
+void
+R_DrawColumnModuloDeferredLow(void);
+
+void
+R_InitDrawers(void);
+
 void
 R_InitBuffer(int width,
 	int height);
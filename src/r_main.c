@@ -29,6 +29,7 @@
 
 #include "r_local.h"
 #include "r_sky.h"
+#include "r_pvs.h"
 
 // Fineangles in the SCREENWIDTH wide window.
 #define FIELDOFVIEW 2048
@@ -55,6 +56,44 @@ int sscount;
 int linecount;
 int loopcount;
 
+// Governor levels, from the player's settings
+//  to low detail, then smaller views down to the
+//  GOVERNOR_MINBLOCKS view size.
+#define GOVERNOR_MINBLOCKS 7
+#define GOVERNOR_MAXLEVELS (11 - GOVERNOR_MINBLOCKS + 2)
+
+// Frames averaged before deciding anything,
+//  and windows under GOVERNOR_IDLE of the
+//  budget before going one level back up.
+// Low detail about halves the refresh time,
+//  so this keeps clear of the budget once up.
+#define GOVERNOR_WINDOW 8
+#define GOVERNOR_IDLEWINDOWS 4
+#define GOVERNOR_IDLE(budget) ((budget) * 2 / 5)
+
+// Totals over all rendered frames, see R_PrintStats.
+static struct r_stats {
+	int frames;
+	long skippednodes;
+	long skippedsubsectors;
+	long fullstops;
+	long pvsculled;
+	long governorchanges;
+	int governorframes[GOVERNOR_MAXLEVELS];
+} r_stats;
+
+int governorfps;
+
+// Refresh time governor, see R_GovernFrame.
+static struct r_governor {
+	int level;
+	int blocks;
+	int detail;
+	int frames;
+	int idlewindows;
+	uint64_t windowtime;
+} r_governor;
+
 fixed_t viewx;
 fixed_t viewy;
 fixed_t viewz;
@@ -105,7 +144,12 @@ void (*colfunc)(void);
 void (*basecolfunc)(void);
 void (*fuzzcolfunc)(void);
 void (*transcolfunc)(void);
+
+// Wall columns of textures not 128 high.
+static void (*pow2colfunc)(void);
+static void (*modulocolfunc)(void);
 void (*spanfunc)(void);
+void (*prelitspanfunc)(void);
 
 //
 // R_AddPointToBox
@@ -547,6 +591,22 @@ R_InitLightTables(void) {
 	}
 }
 
+//
+// R_ColumnFunc
+// Vanilla columns wrap at 128 texels, which
+//  tiles shorter and taller textures wrong.
+//
+colfunc_t
+R_ColumnFunc(int height) {
+	if(height == 128 || height <= 0)
+		return basecolfunc;
+
+	if(!(height & (height - 1)))
+		return pow2colfunc;
+
+	return modulocolfunc;
+}
+
 //
 // R_SetViewSize
 // Do not really change anything here,
@@ -597,15 +657,31 @@ R_ExecuteSetViewSize(void) {
 	projection  = centerxfrac;
 
 	if(!detailshift) {
-		colfunc = basecolfunc = R_DrawColumn;
+		colfunc = basecolfunc = drawcolumnfunc;
 		fuzzcolfunc           = R_DrawFuzzColumn;
 		transcolfunc          = R_DrawTranslatedColumn;
-		spanfunc              = R_DrawSpan;
+		spanfunc              = drawspanfunc;
+		prelitspanfunc        = drawprelitspanfunc;
+		pow2colfunc           = R_DrawColumnPow2;
+		modulocolfunc         = R_DrawColumnModulo;
 	} else {
 		colfunc = basecolfunc = R_DrawColumnLow;
 		fuzzcolfunc           = R_DrawFuzzColumn;
 		transcolfunc          = R_DrawTranslatedColumn;
 		spanfunc              = R_DrawSpanLow;
+		prelitspanfunc        = R_DrawSpanPrelitLow;
+		pow2colfunc           = R_DrawColumnPow2Low;
+		modulocolfunc         = R_DrawColumnModuloLow;
+	}
+
+	if(deferredlight) {
+		colfunc = basecolfunc = detailshift ? R_DrawColumnDeferredLow : R_DrawColumnDeferred;
+		fuzzcolfunc           = R_DrawFuzzColumnDeferred;
+		transcolfunc          = R_DrawTranslatedColumnDeferred;
+		spanfunc              = detailshift ? R_DrawSpanDeferredLow : R_DrawSpanDeferred;
+		prelitspanfunc        = NULL;
+		pow2colfunc           = detailshift ? R_DrawColumnPow2DeferredLow : R_DrawColumnPow2Deferred;
+		modulocolfunc         = detailshift ? R_DrawColumnModuloDeferredLow : R_DrawColumnModuloDeferred;
 	}
 
 	R_InitBuffer(scaledviewwidth, viewheight);
@@ -665,6 +741,8 @@ R_Init(void) {
 	R_InitTables();
 	// viewwidth / viewheight / detailLevel are set by the defaults
 	printf("\nR_InitTables");
+	R_InitDrawers();
+	printf("\nR_InitDrawers");
 
 	R_SetViewSize(screenblocks, detailLevel);
 	R_InitPlanes();
@@ -724,6 +802,8 @@ R_SetupFrame(player_t *player) {
 
 	sscount = 0;
 
+	R_SetupPVS(player->mo->subsector->sector);
+
 	if(player->fixedcolormap) {
 		fixedcolormap = colormaps
 						+ player->fixedcolormap * 256 * sizeof(lighttable_t);
@@ -739,11 +819,99 @@ R_SetupFrame(player_t *player) {
 	validcount++;
 }
 
+//
+// R_GovernorLevel
+// View size and detail of a governor level,
+//  false if there is no such level.
+//
+static boolean
+R_GovernorLevel(int level,
+	int *blocks,
+	int *detail) {
+	*blocks = screenblocks;
+	*detail = detailLevel;
+
+	if(level > 0 && !*detail) {
+		*detail = 1;
+		level--;
+	}
+
+	*blocks -= level;
+
+	return level == 0 || *blocks >= GOVERNOR_MINBLOCKS;
+}
+
+//
+// R_GovernFrame
+// Lowers the view size and detail while rendering
+//  takes more than its part of a frame at governorfps,
+//  and raises them back once it takes much less.
+// Any other change of the view restarts from level 0.
+//
+static void
+R_GovernFrame(uint64_t elapsed) {
+	uint64_t budget;
+	int level;
+	int blocks;
+	int detail;
+
+	r_stats.governorframes[r_governor.level]++;
+
+	if(governorfps <= 0)
+		return;
+
+	if(setblocks != r_governor.blocks || setdetail != r_governor.detail) {
+		r_governor.level       = 0;
+		r_governor.blocks      = setblocks;
+		r_governor.detail      = setdetail;
+		r_governor.frames      = 0;
+		r_governor.idlewindows = 0;
+		r_governor.windowtime  = 0;
+		return;
+	}
+
+	r_governor.windowtime += elapsed;
+	if(++r_governor.frames < GOVERNOR_WINDOW)
+		return;
+
+	// Refresh gets three quarters of a frame,
+	//  the rest is left to the game and the blit.
+	budget = GOVERNOR_WINDOW * 750000 / governorfps;
+	level  = r_governor.level;
+
+	if(r_governor.windowtime > budget) {
+		r_governor.idlewindows = 0;
+		level++;
+	} else if(r_governor.windowtime < GOVERNOR_IDLE(budget)) {
+		if(++r_governor.idlewindows >= GOVERNOR_IDLEWINDOWS) {
+			r_governor.idlewindows = 0;
+			level--;
+		}
+	} else
+		r_governor.idlewindows = 0;
+
+	r_governor.frames     = 0;
+	r_governor.windowtime = 0;
+
+	if(level != r_governor.level && level >= 0
+		&& R_GovernorLevel(level, &blocks, &detail)) {
+		r_governor.level  = level;
+		r_governor.blocks = blocks;
+		r_governor.detail = detail;
+		r_stats.governorchanges++;
+		R_SetViewSize(blocks, detail);
+	}
+}
+
 //
 // R_RenderView
 //
 void
 R_RenderPlayerView(player_t *player) {
+	uint64_t start;
+
+	start = I_GetTimeUS();
+
 	R_SetupFrame(player);
 
 	// Clear buffers.
@@ -758,6 +926,12 @@ R_RenderPlayerView(player_t *player) {
 	// The head node is the last node output.
 	R_RenderBSPNode(numnodes - 1);
 
+	r_stats.frames++;
+	r_stats.skippednodes += numnodes - bspnodecount;
+	r_stats.skippedsubsectors += numsubsectors - sscount;
+	r_stats.fullstops += bspfullstops;
+	r_stats.pvsculled += pvsculled;
+
 	// Check for new console commands.
 	NetUpdate();
 
@@ -768,6 +942,40 @@ R_RenderPlayerView(player_t *player) {
 
 	R_DrawMasked();
 
+	if(deferredlight)
+		R_ResolveLight();
+
 	// Check for new console commands.
 	NetUpdate();
+
+	R_GovernFrame(I_GetTimeUS() - start);
+}
+
+//
+// R_PrintStats
+// Reports refresh counters averaged
+//  over all the rendered frames.
+//
+void
+R_PrintStats(void) {
+	if(!r_stats.frames)
+		return;
+
+	printf("R_PrintStats: %i frames\n", r_stats.frames);
+	printf(" bsp: %li nodes, %li subsectors skipped per frame, %li full screen stops\n",
+		r_stats.skippednodes / r_stats.frames,
+		r_stats.skippedsubsectors / r_stats.frames,
+		r_stats.fullstops);
+	if(pvsrow != NULL)
+		printf(" pvs: %li nodes culled per frame\n",
+			r_stats.pvsculled / r_stats.frames);
+	if(governorfps > 0) {
+		int i;
+
+		printf(" governor: %li changes, frames per level:",
+			r_stats.governorchanges);
+		for(i = 0; i < GOVERNOR_MAXLEVELS; i++)
+			printf(" %i", r_stats.governorframes[i]);
+		putchar('\n');
+	}
 }
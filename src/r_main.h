@@ -45,6 +45,8 @@ extern fixed_t projection;
 
 extern int validcount;
 
+extern int framecount;
+
 extern int linecount;
 extern int loopcount;
 
@@ -89,6 +91,14 @@ extern void (*basecolfunc)(void);
 extern void (*fuzzcolfunc)(void);
 // No shadow effects on floors.
 extern void (*spanfunc)(void);
+extern void (*prelitspanfunc)(void);
+
+typedef void (*colfunc_t)(void);
+
+// Column drawer for a wall texture of the given height,
+//  basecolfunc unless it doesn't wrap at 128 texels.
+colfunc_t
+R_ColumnFunc(int height);
 
 //
 // Utility functions.
@@ -144,4 +154,12 @@ R_Init(void);
 void
 R_SetViewSize(int blocks, int detail);
 
+// Frame rate the view size and detail are
+//  lowered to hold, zero disables the governor.
+extern int governorfps;
+
+// Called by G_CheckDemoStatus.
+void
+R_PrintStats(void);
+
 #endif
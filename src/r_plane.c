@@ -81,13 +81,106 @@ fixed_t cacheddistance[SCREENHEIGHT];
 fixed_t cachedxstep[SCREENHEIGHT];
 fixed_t cachedystep[SCREENHEIGHT];
 
+//
+// Pre-lit flats.
+// Flats lit by a colormap, so spans read
+//  the final color directly.
+// Least recently used are reused first, but never
+//  during the frame they were last used in,
+//  that span is drawn the usual way instead.
+//
+#define FLATSIZE (64 * 64)
+
+// Memory budget, in kilobytes, 0 disables.
+int flatcachekb;
+
+struct r_prelitflat {
+	struct r_prelitflat *prev; // Most recently used first.
+	struct r_prelitflat *next;
+	struct r_prelitflat **slot;
+	int frame;
+	byte pixels[FLATSIZE];
+};
+
+static struct r_prelit {
+	struct r_prelitflat lru;
+	struct r_prelitflat **index; // [numflats][numcolormaps]
+	struct r_prelitflat **row;   // Current plane's flat.
+	int numcolormaps;
+} r_prelit;
+
+// Current plane's flat, unlit.
+static const uint8_t *planesource;
+
 //
 // R_InitPlanes
 // Only at game startup.
 //
 void
 R_InitPlanes(void) {
-	// Doh!
+	struct r_prelitflat *entries;
+	int numentries;
+	int i;
+
+	r_prelit.lru.prev = r_prelit.lru.next = &r_prelit.lru;
+
+	numentries = flatcachekb * 1024 / (int)sizeof(*entries);
+	if(numentries <= 0)
+		return;
+
+	r_prelit.numcolormaps = W_LumpForName("COLORMAP")->size / 256;
+	r_prelit.index        = calloc((size_t)numflats * r_prelit.numcolormaps, sizeof(*r_prelit.index));
+	entries               = calloc(numentries, sizeof(*entries));
+	if(r_prelit.index == NULL || entries == NULL)
+		I_Error("R_InitPlanes: Unable to allocate %i KB of pre-lit flats", flatcachekb);
+
+	for(i = 0; i < numentries; i++) {
+		entries[i].frame      = -1;
+		entries[i].prev       = r_prelit.lru.prev;
+		entries[i].next       = &r_prelit.lru;
+		entries[i].prev->next = &entries[i];
+		r_prelit.lru.prev     = &entries[i];
+	}
+}
+
+//
+// R_PrelitFlat
+// Returns planesource lit by colormap,
+//  or NULL if no entry could be spared.
+//
+static const byte *
+R_PrelitFlat(const lighttable_t *colormap) {
+	struct r_prelitflat **slot;
+	struct r_prelitflat *entry;
+	int i;
+
+	slot  = r_prelit.row + ((colormap - colormaps) >> 8);
+	entry = *slot;
+
+	if(entry == NULL) {
+		entry = r_prelit.lru.prev;
+		if(entry == &r_prelit.lru || entry->frame == framecount)
+			return NULL;
+
+		if(entry->slot != NULL)
+			*entry->slot = NULL;
+		entry->slot = slot;
+		*slot       = entry;
+
+		for(i = 0; i < FLATSIZE; i++)
+			entry->pixels[i] = colormap[planesource[i]];
+	}
+
+	// Move to the front.
+	entry->frame      = framecount;
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+	entry->prev       = &r_prelit.lru;
+	entry->next       = r_prelit.lru.next;
+	entry->next->prev = entry;
+	r_prelit.lru.next = entry;
+
+	return entry->pixels;
 }
 
 //
@@ -153,7 +246,13 @@ R_MapPlane(int y,
 	ds_x2 = x2;
 
 	// high or low detail
-	spanfunc();
+	if(r_prelit.row != NULL
+		&& (ds_source = R_PrelitFlat(ds_colormap)) != NULL) {
+		prelitspanfunc();
+	} else {
+		ds_source = planesource;
+		spanfunc();
+	}
 }
 
 //
@@ -320,6 +419,7 @@ R_DrawPlanes(void) {
 	int x;
 	int stop;
 	int angle;
+	colfunc_t skycolfunc;
 
 #ifdef RANGECHECK
 	if(ds_p - drawsegs > MAXDRAWSEGS)
@@ -349,6 +449,8 @@ R_DrawPlanes(void) {
 			//  by INVUL inverse mapping.
 			dc_colormap   = colormaps;
 			dc_texturemid = skytexturemid;
+			dc_texheight  = textureheight[skytexture] >> FRACBITS;
+			skycolfunc    = R_ColumnFunc(dc_texheight);
 			for(x = pl->minx; x <= pl->maxx; x++) {
 				dc_yl = pl->top[x];
 				dc_yh = pl->bottom[x];
@@ -357,14 +459,18 @@ R_DrawPlanes(void) {
 					angle     = (viewangle + xtoviewangle[x]) >> ANGLETOSKYSHIFT;
 					dc_x      = x;
 					dc_source = R_GetColumn(skytexture, angle);
-					colfunc();
+					skycolfunc();
 				}
 			}
 			continue;
 		}
 
 		// regular flat
-		ds_source = W_LumpForId(firstflat + flattranslation[pl->picnum])->data;
+		planesource = W_LumpForId(flatlumps[flattranslation[pl->picnum]])->data;
+		if(r_prelit.index != NULL && prelitspanfunc != NULL)
+			r_prelit.row = r_prelit.index + flattranslation[pl->picnum] * r_prelit.numcolormaps;
+		else
+			r_prelit.row = NULL;
 
 		planeheight = abs(pl->height - viewz);
 		light       = (pl->lightlevel >> LIGHTSEGSHIFT) + extralight;
@@ -38,6 +38,9 @@ extern short ceilingclip[SCREENWIDTH];
 extern fixed_t yslope[SCREENHEIGHT];
 extern fixed_t distscale[SCREENWIDTH];
 
+// Pre-lit flat cache budget, in kilobytes.
+extern int flatcachekb;
+
 void
 R_InitPlanes(void);
 void
@@ -0,0 +1,568 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+// Copyright (C) 2020 by Valentin Debon.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Potentially visible sets, sector to sector.
+//	Sectors are the cells, two sided lines between
+//	 different sectors the portals, and one sided lines
+//	 the only occluders. Heights are ignored, doors and
+//	 lifts can't hide anything, the result is conservative.
+//	Visibility through chains of portals is found by
+//	 clipping them against their separating lines,
+//	 the same way the vis tools of later engines did.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "doomdef.h"
+
+#include "z_zone.h"
+#include "i_system.h"
+#include "m_argv.h"
+#include "m_misc.h"
+
+#include "doomdata.h"
+#include "r_state.h"
+
+#include "r_pvs.h"
+
+// Bumped whenever the algorithm changes, invalidates the cache.
+#define PVS_VERSION 1
+
+// Map units, points closer than that to a line are on it.
+#define PVS_EPSILON (1.0 / 64)
+
+// Longest chain of portals followed before giving up.
+#define PVS_MAXDEPTH 256
+
+// Steps allowed from a single source portal before giving up.
+#define PVS_MAXWORK (1 << 18)
+
+const byte *pvsrow;
+const byte *pvsnodes;
+int pvsculled;
+
+struct r_pvswinding {
+	double x1, y1;
+	double x2, y2;
+};
+
+// One direction of a two sided line,
+//  the source sector is on the right.
+struct r_pvsportal {
+	struct r_pvswinding w;
+	int line;
+	int to;
+	byte *mightsee;
+};
+
+struct r_pvsheader {
+	char magic[4];
+	int32_t version;
+	int32_t numsectors;
+	int32_t rowbytes;
+	uint64_t key;
+};
+
+static struct r_pvs {
+	int rowbytes;
+	byte *matrix;
+	byte *nodes;
+	const sector_t *viewsector;
+
+	// Only while building.
+	struct r_pvsportal *portals;
+	int numportals;
+	int *firstportal; // Per sector, numsectors + 1 entries.
+	byte *onstack;    // Per line.
+	byte *vis;
+	byte *mightstack;
+	long work;
+} r_pvs;
+
+#define PVS_TEST(set, n) ((set)[(n) >> 3] & 1 << ((n)&7))
+#define PVS_SET(set, n) ((set)[(n) >> 3] |= 1 << ((n)&7))
+
+static inline double
+R_PVSCross(double x1,
+	double y1,
+	double x2,
+	double y2,
+	double x,
+	double y) {
+	return (x2 - x1) * (y - y1) - (y2 - y1) * (x - x1);
+}
+
+//
+// R_PVSClip
+// Keeps the part of w left of (x1,y1)->(x2,y2).
+// Returns false if nothing worth following remains.
+//
+static boolean
+R_PVSClip(struct r_pvswinding *w,
+	double x1,
+	double y1,
+	double x2,
+	double y2) {
+	double d1 = R_PVSCross(x1, y1, x2, y2, w->x1, w->y1);
+	double d2 = R_PVSCross(x1, y1, x2, y2, w->x2, w->y2);
+	double t, dx, dy;
+
+	if(d1 >= -PVS_EPSILON && d2 >= -PVS_EPSILON)
+		return true;
+
+	if(d1 < -PVS_EPSILON && d2 < -PVS_EPSILON)
+		return false;
+
+	t  = d1 / (d1 - d2);
+	dx = w->x1 + t * (w->x2 - w->x1);
+	dy = w->y1 + t * (w->y2 - w->y1);
+
+	if(d1 < -PVS_EPSILON) {
+		w->x1 = dx;
+		w->y1 = dy;
+	} else {
+		w->x2 = dx;
+		w->y2 = dy;
+	}
+
+	return fabs(w->x2 - w->x1) + fabs(w->y2 - w->y1) > PVS_EPSILON;
+}
+
+//
+// R_PVSClipSeparators
+// Clips target to what can be reached by lines
+//  going through both source and pass.
+// A line through an end of source and an end of pass,
+//  with the rest of source and pass on opposite sides,
+//  bounds that region on the side of pass.
+//
+static boolean
+R_PVSClipSeparators(const struct r_pvswinding *source,
+	const struct r_pvswinding *pass,
+	struct r_pvswinding *target) {
+	const double sx[2] = { source->x1, source->x2 };
+	const double sy[2] = { source->y1, source->y2 };
+	const double px[2] = { pass->x1, pass->x2 };
+	const double py[2] = { pass->y1, pass->y2 };
+	double ds, dp;
+	int i, j;
+
+	for(i = 0; i < 2; i++) {
+		for(j = 0; j < 2; j++) {
+			ds = R_PVSCross(sx[i], sy[i], px[j], py[j], sx[!i], sy[!i]);
+			dp = R_PVSCross(sx[i], sy[i], px[j], py[j], px[!j], py[!j]);
+
+			if(fabs(dp) <= PVS_EPSILON)
+				continue;
+
+			if(dp > 0) {
+				if(ds > 0)
+					continue;
+				if(!R_PVSClip(target, sx[i], sy[i], px[j], py[j]))
+					return false;
+			} else {
+				if(ds < 0)
+					continue;
+				if(!R_PVSClip(target, px[j], py[j], sx[i], sy[i]))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+//
+// R_PVSBaseFlood
+// Sectors reachable from p through portals in front of it,
+//  regardless of the portals in between.
+// Used to prune R_PVSFlow.
+//
+static void
+R_PVSBaseFlood(struct r_pvsportal *p,
+	int *stack) {
+	const struct r_pvswinding *pw = &p->w;
+	const struct r_pvsportal *q;
+	int sp, cell, i;
+
+	sp          = 0;
+	stack[sp++] = p->to;
+	PVS_SET(p->mightsee, p->to);
+
+	while(sp) {
+		cell = stack[--sp];
+
+		for(i = r_pvs.firstportal[cell]; i < r_pvs.firstportal[cell + 1]; i++) {
+			q = &r_pvs.portals[i];
+
+			if(PVS_TEST(p->mightsee, q->to))
+				continue;
+
+			// q must be partly in front of p.
+			if(R_PVSCross(pw->x1, pw->y1, pw->x2, pw->y2, q->w.x1, q->w.y1) <= PVS_EPSILON
+				&& R_PVSCross(pw->x1, pw->y1, pw->x2, pw->y2, q->w.x2, q->w.y2) <= PVS_EPSILON)
+				continue;
+
+			// And p partly behind q.
+			if(R_PVSCross(q->w.x1, q->w.y1, q->w.x2, q->w.y2, pw->x1, pw->y1) >= -PVS_EPSILON
+				&& R_PVSCross(q->w.x1, q->w.y1, q->w.x2, q->w.y2, pw->x2, pw->y2) >= -PVS_EPSILON)
+				continue;
+
+			PVS_SET(p->mightsee, q->to);
+			stack[sp++] = q->to;
+		}
+	}
+}
+
+//
+// R_PVSFlow
+// Marks cell visible from s, then follows
+//  every portal out of it still in sight.
+//
+static void
+R_PVSFlow(const struct r_pvsportal *s,
+	int cell,
+	const struct r_pvswinding *source,
+	const struct r_pvswinding *pass,
+	const byte *might,
+	int depth) {
+	const struct r_pvsportal *q;
+	struct r_pvswinding newsource, target;
+	byte *newmight;
+	int i, k, more;
+
+	PVS_SET(r_pvs.vis, cell);
+
+	// Too deep or too long, assume everything still possible is seen.
+	if(depth == PVS_MAXDEPTH || --r_pvs.work < 0) {
+		for(k = 0; k < r_pvs.rowbytes; k++)
+			r_pvs.vis[k] |= might[k];
+		return;
+	}
+
+	newmight = r_pvs.mightstack + depth * r_pvs.rowbytes;
+
+	for(i = r_pvs.firstportal[cell]; i < r_pvs.firstportal[cell + 1]; i++) {
+		q = &r_pvs.portals[i];
+
+		// A straight line crosses a line only once.
+		if(r_pvs.onstack[q->line] || !PVS_TEST(might, q->to))
+			continue;
+
+		more = 0;
+		for(k = 0; k < r_pvs.rowbytes; k++) {
+			newmight[k] = might[k] & q->mightsee[k];
+			more |= newmight[k] & ~r_pvs.vis[k];
+		}
+
+		if(!more)
+			continue;
+
+		// Target beyond the source and the pass,
+		//  source behind the target.
+		target    = q->w;
+		newsource = *source;
+
+		if(!R_PVSClip(&target, s->w.x1, s->w.y1, s->w.x2, s->w.y2)
+			|| !R_PVSClip(&newsource, q->w.x2, q->w.y2, q->w.x1, q->w.y1))
+			continue;
+
+		if(pass != NULL
+			&& (!R_PVSClip(&target, pass->x1, pass->y1, pass->x2, pass->y2)
+				|| !R_PVSClipSeparators(&newsource, pass, &target)
+				|| !R_PVSClipSeparators(&target, pass, &newsource)))
+			continue;
+
+		r_pvs.onstack[q->line] = 1;
+		R_PVSFlow(s, q->to, &newsource, &target, newmight, depth + 1);
+		r_pvs.onstack[q->line] = 0;
+	}
+}
+
+//
+// R_PVSAddPortal
+//
+static void
+R_PVSAddPortal(int line,
+	const vertex_t *v1,
+	const vertex_t *v2,
+	const sector_t *from,
+	const sector_t *to) {
+	struct r_pvsportal *p;
+	int *count;
+
+	// Counting pass.
+	if(r_pvs.portals == NULL) {
+		count = &r_pvs.firstportal[from - sectors + 1];
+		++*count;
+		return;
+	}
+
+	p       = &r_pvs.portals[r_pvs.firstportal[from - sectors]++];
+	p->w.x1 = (double)v1->x / FRACUNIT;
+	p->w.y1 = (double)v1->y / FRACUNIT;
+	p->w.x2 = (double)v2->x / FRACUNIT;
+	p->w.y2 = (double)v2->y / FRACUNIT;
+	p->line = line;
+	p->to   = to - sectors;
+}
+
+//
+// R_PVSAddPortals
+//
+static void
+R_PVSAddPortals(void) {
+	const line_t *li;
+	int i;
+
+	for(i = 0, li = lines; i < numlines; i++, li++) {
+		if(li->backsector == NULL || li->backsector == li->frontsector
+			|| (li->dx == 0 && li->dy == 0))
+			continue;
+
+		// Front sector is on the right of v1->v2.
+		R_PVSAddPortal(i, li->v1, li->v2, li->frontsector, li->backsector);
+		R_PVSAddPortal(i, li->v2, li->v1, li->backsector, li->frontsector);
+	}
+}
+
+//
+// R_BuildPVS
+// Fills the matrix, one row per sector.
+//
+static void
+R_BuildPVS(void) {
+	struct r_pvsportal *p;
+	struct r_pvswinding source;
+	byte *row, *mightsee;
+	int *stack;
+	int i, k, cell;
+
+	// Sort portals by source sector, in two passes.
+	r_pvs.firstportal = calloc(numsectors + 1, sizeof(*r_pvs.firstportal));
+	if(r_pvs.firstportal == NULL)
+		I_Error("R_BuildPVS: Unable to allocate portals");
+
+	r_pvs.portals = NULL;
+	R_PVSAddPortals();
+	for(i = 0; i < numsectors; i++)
+		r_pvs.firstportal[i + 1] += r_pvs.firstportal[i];
+	r_pvs.numportals = r_pvs.firstportal[numsectors];
+
+	r_pvs.portals    = malloc((r_pvs.numportals + 1) * sizeof(*r_pvs.portals));
+	r_pvs.onstack    = calloc(numlines, 1);
+	r_pvs.vis        = malloc(r_pvs.rowbytes);
+	r_pvs.mightstack = malloc((size_t)PVS_MAXDEPTH * r_pvs.rowbytes);
+	stack            = malloc(r_pvs.numportals * sizeof(*stack) + sizeof(*stack));
+	mightsee         = calloc(r_pvs.numportals + 1, r_pvs.rowbytes);
+	if(r_pvs.portals == NULL || r_pvs.onstack == NULL || r_pvs.vis == NULL
+		|| r_pvs.mightstack == NULL || stack == NULL || mightsee == NULL)
+		I_Error("R_BuildPVS: Unable to allocate portals");
+
+	// Filling shifts each start to the next one.
+	R_PVSAddPortals();
+	memmove(r_pvs.firstportal + 1, r_pvs.firstportal, numsectors * sizeof(*r_pvs.firstportal));
+	r_pvs.firstportal[0] = 0;
+
+	for(i = 0, p = r_pvs.portals; i < r_pvs.numportals; i++, p++) {
+		p->mightsee = mightsee + (size_t)i * r_pvs.rowbytes;
+		R_PVSBaseFlood(p, stack);
+	}
+
+	memset(r_pvs.matrix, 0, (size_t)numsectors * r_pvs.rowbytes);
+
+	for(cell = 0; cell < numsectors; cell++) {
+		row = r_pvs.matrix + (size_t)cell * r_pvs.rowbytes;
+		PVS_SET(row, cell);
+
+		for(i = r_pvs.firstportal[cell]; i < r_pvs.firstportal[cell + 1]; i++) {
+			p = &r_pvs.portals[i];
+
+			memset(r_pvs.vis, 0, r_pvs.rowbytes);
+			source     = p->w;
+			r_pvs.work = PVS_MAXWORK;
+
+			r_pvs.onstack[p->line] = 1;
+			R_PVSFlow(p, p->to, &source, NULL, p->mightsee, 0);
+			r_pvs.onstack[p->line] = 0;
+
+			for(k = 0; k < r_pvs.rowbytes; k++)
+				row[k] |= r_pvs.vis[k];
+		}
+	}
+
+	free(mightsee);
+	free(stack);
+	free(r_pvs.mightstack);
+	free(r_pvs.vis);
+	free(r_pvs.onstack);
+	free(r_pvs.portals);
+	free(r_pvs.firstportal);
+	r_pvs.portals = NULL;
+}
+
+//
+// R_PVSKey
+// Everything the PVS depends on.
+//
+static uint64_t
+R_PVSKey(lumpId_t maplump) {
+	static const int lumps[] = { ML_LINEDEFS, ML_SIDEDEFS, ML_VERTEXES };
+	const struct w_lump *lump;
+	uint64_t key = M_HASHINIT;
+	int32_t header[2] = { PVS_VERSION, numsectors };
+	int i;
+
+	key = M_Hash(header, sizeof(header), key);
+	for(i = 0; i < (int)(sizeof(lumps) / sizeof(*lumps)); i++) {
+		lump = W_LumpForId(maplump + lumps[i]);
+		key  = M_Hash(lump->data, lump->size, key);
+	}
+
+	return key;
+}
+
+//
+// R_ReadPVS
+//
+static boolean
+R_ReadPVS(const char *path,
+	uint64_t key) {
+	struct r_pvsheader header;
+	size_t size = (size_t)numsectors * r_pvs.rowbytes;
+	boolean valid;
+	FILE *file;
+
+	file = fopen(path, "rb");
+	if(file == NULL)
+		return false;
+
+	valid = fread(&header, sizeof(header), 1, file) == 1
+		&& memcmp(header.magic, "RPVS", 4) == 0
+		&& header.version == PVS_VERSION
+		&& header.numsectors == numsectors
+		&& header.rowbytes == r_pvs.rowbytes
+		&& header.key == key
+		&& fread(r_pvs.matrix, 1, size, file) == size;
+
+	fclose(file);
+
+	return valid;
+}
+
+//
+// R_WritePVS
+//
+static void
+R_WritePVS(const char *path,
+	uint64_t key) {
+	struct r_pvsheader header = {
+		.magic      = { 'R', 'P', 'V', 'S' },
+		.version    = PVS_VERSION,
+		.numsectors = numsectors,
+		.rowbytes   = r_pvs.rowbytes,
+		.key        = key,
+	};
+	size_t size = (size_t)numsectors * r_pvs.rowbytes;
+	FILE *file;
+
+	file = fopen(path, "wb");
+	if(file == NULL)
+		return;
+
+	if(fwrite(&header, sizeof(header), 1, file) != 1
+		|| fwrite(r_pvs.matrix, 1, size, file) != size) {
+		fclose(file);
+		remove(path);
+		return;
+	}
+
+	fclose(file);
+}
+
+//
+// R_LoadPVS
+//
+void
+R_LoadPVS(lumpId_t maplump) {
+	char name[32], path[1024];
+	boolean cached;
+	uint64_t key;
+
+	// Sector pointers are reused from a level to the next.
+	pvsrow           = NULL;
+	pvsnodes         = NULL;
+	r_pvs.nodes      = NULL;
+	r_pvs.viewsector = NULL;
+
+	if(!M_CheckParm("-pvs") || numsectors == 0 || numnodes == 0)
+		return;
+
+	r_pvs.rowbytes = (numsectors + 7) >> 3;
+	r_pvs.matrix   = Z_Malloc((size_t)numsectors * r_pvs.rowbytes, PU_LEVEL, 0);
+	r_pvs.nodes    = Z_Malloc(numnodes, PU_LEVEL, 0);
+
+	key = R_PVSKey(maplump);
+	snprintf(name, sizeof(name), "pvs-%016llx", (unsigned long long)key);
+	cached = M_CachePath(path, sizeof(path), name);
+
+	if(!cached || !R_ReadPVS(path, key)) {
+		R_BuildPVS();
+		if(cached)
+			R_WritePVS(path, key);
+	}
+}
+
+//
+// R_PVSMarkNodes
+// Returns true if any subsector below is potentially visible.
+//
+static boolean
+R_PVSMarkNodes(int bspnum) {
+	const node_t *bsp;
+	boolean visible;
+
+	if(bspnum & NF_SUBSECTOR)
+		return R_PVSVISIBLE(subsectors[bspnum & ~NF_SUBSECTOR].sector) != 0;
+
+	bsp     = &nodes[bspnum];
+	visible = R_PVSMarkNodes(bsp->children[0]);
+	visible |= R_PVSMarkNodes(bsp->children[1]);
+
+	r_pvs.nodes[bspnum] = visible;
+
+	return visible;
+}
+
+//
+// R_SetupPVS
+//
+void
+R_SetupPVS(const sector_t *viewsector) {
+	pvsculled = 0;
+
+	if(r_pvs.nodes == NULL || viewsector == r_pvs.viewsector)
+		return;
+
+	r_pvs.viewsector = viewsector;
+	pvsrow           = r_pvs.matrix + (viewsector - sectors) * r_pvs.rowbytes;
+	pvsnodes         = r_pvs.nodes;
+
+	R_PVSMarkNodes(numnodes - 1);
+}
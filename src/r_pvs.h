@@ -0,0 +1,51 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright (C) 1993-1996 by id Software, Inc.
+// Copyright (C) 2020 by Valentin Debon.
+//
+// This source is available for distribution and/or modification
+// only under the terms of the DOOM Source Code License as
+// published by id Software. All rights reserved.
+//
+// The source is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// FITNESS FOR A PARTICULAR PURPOSE. See the DOOM Source Code License
+// for more details.
+//
+// DESCRIPTION:
+//	Potentially visible sets, sector to sector.
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __R_PVS__
+#define __R_PVS__
+
+#include "r_defs.h"
+#include "w_wad.h"
+
+#ifdef __GNUG__
+#pragma interface
+#endif
+
+// Row of the view sector, NULL when the PVS is disabled.
+extern const byte *pvsrow;
+
+// Per node flag, set if anything below it is in pvsrow.
+extern const byte *pvsnodes;
+
+// Nodes culled this frame, just for profiling purposes.
+extern int pvsculled;
+
+#define R_PVSVISIBLE(sec) \
+	(pvsrow == NULL || pvsrow[((sec) - sectors) >> 3] & 1 << (((sec) - sectors) & 7))
+
+// Called by P_SetupLevel, after P_GroupLines.
+// Only builds (or loads) the PVS when -pvs was given.
+void
+R_LoadPVS(lumpId_t maplump);
+
+// Called by R_SetupFrame.
+void
+R_SetupPVS(const sector_t *viewsector);
+
+#endif
@@ -41,6 +41,14 @@ int toptexture;
 int bottomtexture;
 int midtexture;
 
+// drawers and heights of the above
+static colfunc_t topcolfunc;
+static colfunc_t bottomcolfunc;
+static colfunc_t midcolfunc;
+static int topheight;
+static int bottomheight;
+static int midheight;
+
 angle_t rw_normalangle;
 // angle to line origin
 int rw_angle1;
@@ -155,7 +163,7 @@ R_RenderMaskedSegRange(drawseg_t *ds,
 			dc_iscale    = 0xffffffffu / (unsigned)spryscale;
 
 			// draw the texture
-			col = (column_t *)((byte *)R_GetColumn(texnum, maskedtexturecol[dc_x]) - 3);
+			col = (column_t *)((byte *)R_GetMaskedColumn(texnum, maskedtexturecol[dc_x]) - 3);
 
 			R_DrawMaskedColumn(col);
 			maskedtexturecol[dc_x] = MAXSHORT;
@@ -164,6 +172,106 @@ R_RenderMaskedSegRange(drawseg_t *ds,
 	}
 }
 
+#define HEIGHTBITS 12
+#define HEIGHTUNIT (1 << HEIGHTBITS)
+
+// Per column values of the seg being rendered,
+//  filled by R_PrepareSegLoop for R_RenderSegLoop.
+static int segyl[SCREENWIDTH];
+static int segyh[SCREENWIDTH];
+static int segtopmid[SCREENWIDTH];
+static int segbottommid[SCREENWIDTH];
+static fixed_t segcolumn[SCREENWIDTH];
+static fixed_t segiscale[SCREENWIDTH];
+static const lighttable_t *segcolormaps[SCREENWIDTH];
+
+//
+// R_PrepareSegLoop
+// Steps the seg over all its columns at once.
+// Each loop only does fixed point arithmetic into
+//  the seg arrays, so they are vectorizable at -O2/-O3,
+//  except the texture column and lighting one.
+// The bottom tier is clipped while drawing, as it
+//  depends on the ceiling clip the top tier sets.
+//
+static void
+R_PrepareSegLoop(void) {
+	const int start = rw_x;
+	const int stop  = rw_stopx;
+	fixed_t frac;
+	fixed_t step;
+	fixed_t scale;
+	angle_t angle;
+	unsigned index;
+	int x;
+
+	frac = topfrac;
+	for(x = start; x < stop; x++) {
+		int yl = (frac + HEIGHTUNIT - 1) >> HEIGHTBITS;
+
+		// no space above wall?
+		if(yl < ceilingclip[x] + 1)
+			yl = ceilingclip[x] + 1;
+
+		segyl[x] = yl;
+		frac += topstep;
+	}
+
+	frac = bottomfrac;
+	for(x = start; x < stop; x++) {
+		int yh = frac >> HEIGHTBITS;
+
+		if(yh >= floorclip[x])
+			yh = floorclip[x] - 1;
+
+		segyh[x] = yh;
+		frac += bottomstep;
+	}
+
+	if(toptexture) {
+		frac = pixhigh;
+		step = pixhighstep;
+		for(x = start; x < stop; x++) {
+			int mid = frac >> HEIGHTBITS;
+
+			if(mid >= floorclip[x])
+				mid = floorclip[x] - 1;
+
+			segtopmid[x] = mid;
+			frac += step;
+		}
+	}
+
+	if(bottomtexture) {
+		frac = pixlow;
+		step = pixlowstep;
+		for(x = start; x < stop; x++) {
+			segbottommid[x] = (frac + HEIGHTUNIT - 1) >> HEIGHTBITS;
+			frac += step;
+		}
+	}
+
+	// texturecolumn and lighting are independent of wall tiers
+	if(segtextured) {
+		scale = rw_scale;
+		for(x = start; x < stop; x++) {
+			// calculate texture offset
+			angle        = (rw_centerangle + xtoviewangle[x]) >> ANGLETOFINESHIFT;
+			segcolumn[x] = (rw_offset - FixedMul(finetangent[angle], rw_distance)) >> FRACBITS;
+
+			// calculate lighting
+			index = scale >> LIGHTSCALESHIFT;
+
+			if(index >= MAXLIGHTSCALE)
+				index = MAXLIGHTSCALE - 1;
+
+			segcolormaps[x] = walllights[index];
+			segiscale[x]    = 0xffffffffu / (unsigned)scale;
+			scale += rw_scalestep;
+		}
+	}
+}
+
 //
 // R_RenderSegLoop
 // Draws zero, one, or two textures (and possibly a masked
@@ -172,30 +280,21 @@ R_RenderMaskedSegRange(drawseg_t *ds,
 //  textures.
 // CALLED: CORE LOOPING ROUTINE.
 //
-#define HEIGHTBITS 12
-#define HEIGHTUNIT (1 << HEIGHTBITS)
-
 void
 R_RenderSegLoop(void) {
-	angle_t angle;
-	unsigned index;
 	int yl;
 	int yh;
 	int mid;
-	fixed_t texturecolumn;
 	int top;
 	int bottom;
 
-	//texturecolumn = 0;				// shut up compiler warning
+	R_PrepareSegLoop();
 
 	for(; rw_x < rw_stopx; rw_x++) {
-		// mark floor / ceiling areas
-		yl = (topfrac + HEIGHTUNIT - 1) >> HEIGHTBITS;
-
-		// no space above wall?
-		if(yl < ceilingclip[rw_x] + 1)
-			yl = ceilingclip[rw_x] + 1;
+		yl = segyl[rw_x];
+		yh = segyh[rw_x];
 
+		// mark floor / ceiling areas
 		if(markceiling) {
 			top    = ceilingclip[rw_x] + 1;
 			bottom = yl - 1;
@@ -209,11 +308,6 @@ R_RenderSegLoop(void) {
 			}
 		}
 
-		yh = bottomfrac >> HEIGHTBITS;
-
-		if(yh >= floorclip[rw_x])
-			yh = floorclip[rw_x] - 1;
-
 		if(markfloor) {
 			top    = yh + 1;
 			bottom = floorclip[rw_x] - 1;
@@ -225,21 +319,10 @@ R_RenderSegLoop(void) {
 			}
 		}
 
-		// texturecolumn and lighting are independent of wall tiers
 		if(segtextured) {
-			// calculate texture offset
-			angle         = (rw_centerangle + xtoviewangle[rw_x]) >> ANGLETOFINESHIFT;
-			texturecolumn = rw_offset - FixedMul(finetangent[angle], rw_distance);
-			texturecolumn >>= FRACBITS;
-			// calculate lighting
-			index = rw_scale >> LIGHTSCALESHIFT;
-
-			if(index >= MAXLIGHTSCALE)
-				index = MAXLIGHTSCALE - 1;
-
-			dc_colormap = walllights[index];
+			dc_colormap = segcolormaps[rw_x];
 			dc_x        = rw_x;
-			dc_iscale   = 0xffffffffu / (unsigned)rw_scale;
+			dc_iscale   = segiscale[rw_x];
 		}
 
 		// draw the wall tiers
@@ -248,26 +331,24 @@ R_RenderSegLoop(void) {
 			dc_yl         = yl;
 			dc_yh         = yh;
 			dc_texturemid = rw_midtexturemid;
-			dc_source     = R_GetColumn(midtexture, texturecolumn);
-			colfunc();
+			dc_texheight  = midheight;
+			dc_source     = R_GetColumn(midtexture, segcolumn[rw_x]);
+			midcolfunc();
 			ceilingclip[rw_x] = viewheight;
 			floorclip[rw_x]   = -1;
 		} else {
 			// two sided line
 			if(toptexture) {
 				// top wall
-				mid = pixhigh >> HEIGHTBITS;
-				pixhigh += pixhighstep;
-
-				if(mid >= floorclip[rw_x])
-					mid = floorclip[rw_x] - 1;
+				mid = segtopmid[rw_x];
 
 				if(mid >= yl) {
 					dc_yl         = yl;
 					dc_yh         = mid;
 					dc_texturemid = rw_toptexturemid;
-					dc_source     = R_GetColumn(toptexture, texturecolumn);
-					colfunc();
+					dc_texheight  = topheight;
+					dc_source     = R_GetColumn(toptexture, segcolumn[rw_x]);
+					topcolfunc();
 					ceilingclip[rw_x] = mid;
 				} else
 					ceilingclip[rw_x] = yl - 1;
@@ -279,8 +360,7 @@ R_RenderSegLoop(void) {
 
 			if(bottomtexture) {
 				// bottom wall
-				mid = (pixlow + HEIGHTUNIT - 1) >> HEIGHTBITS;
-				pixlow += pixlowstep;
+				mid = segbottommid[rw_x];
 
 				// no space above wall?
 				if(mid <= ceilingclip[rw_x])
@@ -290,9 +370,9 @@ R_RenderSegLoop(void) {
 					dc_yl         = mid;
 					dc_yh         = yh;
 					dc_texturemid = rw_bottomtexturemid;
-					dc_source     = R_GetColumn(bottomtexture,
-                        texturecolumn);
-					colfunc();
+					dc_texheight  = bottomheight;
+					dc_source     = R_GetColumn(bottomtexture, segcolumn[rw_x]);
+					bottomcolfunc();
 					floorclip[rw_x] = mid;
 				} else
 					floorclip[rw_x] = yh + 1;
@@ -305,13 +385,9 @@ R_RenderSegLoop(void) {
 			if(maskedtexture) {
 				// save texturecol
 				//  for backdrawing of masked mid texture
-				maskedtexturecol[rw_x] = texturecolumn;
+				maskedtexturecol[rw_x] = segcolumn[rw_x];
 			}
 		}
-
-		rw_scale += rw_scalestep;
-		topfrac += topstep;
-		bottomfrac += bottomstep;
 	}
 }
 
@@ -522,6 +598,14 @@ R_StoreWallRange(int start,
 	// calculate rw_offset (only needed for textured lines)
 	segtextured = midtexture | toptexture | bottomtexture | maskedtexture;
 
+	// pick drawers wrapping at each tier's height
+	midheight     = textureheight[midtexture] >> FRACBITS;
+	topheight     = textureheight[toptexture] >> FRACBITS;
+	bottomheight  = textureheight[bottomtexture] >> FRACBITS;
+	midcolfunc    = R_ColumnFunc(midheight);
+	topcolfunc    = R_ColumnFunc(topheight);
+	bottomcolfunc = R_ColumnFunc(bottomheight);
+
 	if(segtextured) {
 		offsetangle = rw_normalangle - rw_angle1;
 
@@ -21,6 +21,7 @@
 // Need data structure definitions.
 #include "d_player.h"
 #include "r_data.h"
+#include "w_wad.h"
 
 #ifdef __GNUG__
 #pragma interface
@@ -46,15 +47,17 @@ extern int viewwidth;
 extern int scaledviewwidth;
 extern int viewheight;
 
-extern int firstflat;
+// Lumps of the flats namespace.
+extern const lumpId_t *flatlumps;
+extern int numflats;
 
 // for global animation
 extern int *flattranslation;
 extern int *texturetranslation;
 
 // Sprite....
-extern int firstspritelump;
-extern int lastspritelump;
+// Lumps of the sprites namespace.
+extern const lumpId_t *spritelumps;
 extern int numspritelumps;
 
 //
@@ -113,7 +113,7 @@ R_InstallSpriteLump(int lump,
 
 		sprtemp[frame].rotate = false;
 		for(r = 0; r < 8; r++) {
-			sprtemp[frame].lump[r] = lump - firstspritelump;
+			sprtemp[frame].lump[r] = lump;
 			sprtemp[frame].flip[r] = (byte)flipped;
 		}
 		return;
@@ -137,7 +137,7 @@ R_InstallSpriteLump(int lump,
 			'A' + frame,
 			'1' + rotation);
 
-	sprtemp[frame].lump[rotation] = lump - firstspritelump;
+	sprtemp[frame].lump[rotation] = lump;
 	sprtemp[frame].flip[rotation] = (byte)flipped;
 }
 
@@ -160,7 +160,15 @@ void
 R_InitSpriteDefs(const char **namelist) {
 	int frame;
 	int rotation;
-	int patched;
+	int *names;     // hash of the sprite names, -1 if empty
+	unsigned namesmask;
+	int *first;     // [numsprites] first lump of each sprite
+	int *next;      // [numspritelumps] next lump of the same sprite
+	uint32_t intname;
+	unsigned h;
+	int mark;
+	int i;
+	int l;
 
 	// count the number of sprite names
 	const char **namelistend = namelist;
@@ -175,40 +183,60 @@ R_InitSpriteDefs(const char **namelist) {
 
 	sprites = Z_Malloc(numsprites * sizeof(*sprites), PU_STATIC, NULL);
 
-	const lumpId_t start = firstspritelump;
-	const lumpId_t end   = lastspritelump + 1;
+	mark = Z_ScratchMark(&framescratch);
+
+	// hash the sprite names,
+	// just compare 4 characters as ints
+	namesmask = 15;
+	while(namesmask + 1 < (unsigned)numsprites * 2)
+		namesmask = namesmask * 2 + 1;
 
-	// scan all the lump names for each of the names,
-	//  noting the highest frame letter.
-	// Just compare 4 characters as ints
-	for(int i = 0; i < numsprites; i++) {
+	names = Z_ScratchAlloc(&framescratch, (namesmask + 1) * sizeof(*names));
+	memset(names, -1, (namesmask + 1) * sizeof(*names));
+
+	for(i = 0; i < numsprites; i++) {
+		memcpy(&intname, namelist[i], sizeof(intname));
+		for(h = intname * 0x9E3779B9u >> 16 & namesmask; names[h] != -1; h = (h + 1) & namesmask)
+			;
+		names[h] = i;
+	}
+
+	// scan the sprite lumps once, chaining each to its sprite,
+	//  backwards so every chain is in lump order
+	first = Z_ScratchAlloc(&framescratch, numsprites * sizeof(*first));
+	next  = Z_ScratchAlloc(&framescratch, numspritelumps * sizeof(*next));
+	memset(first, -1, numsprites * sizeof(*first));
+
+	for(l = numspritelumps - 1; l >= 0; l--) {
+		memcpy(&intname, W_LumpForId(spritelumps[l])->name, sizeof(intname));
+		for(h = intname * 0x9E3779B9u >> 16 & namesmask; names[h] != -1; h = (h + 1) & namesmask) {
+			if(memcmp(&intname, namelist[names[h]], sizeof(intname)) == 0) {
+				next[l]         = first[names[h]];
+				first[names[h]] = l;
+				break;
+			}
+		}
+	}
+
+	for(i = 0; i < numsprites; i++) {
 		spritename = namelist[i];
 		memset(sprtemp, -1, sizeof(sprtemp));
 
 		maxframe = -1;
 
-		const uint32_t intname = *(uint32_t *)namelist[i];
-		// scan the lumps,
-		//  filling in the frames for whatever is found
-		for(lumpId_t id = start; id < end; id++) {
-			const struct w_lump *lump = W_LumpForId(id);
+		// filling in the frames for whatever is found,
+		//  noting the highest frame letter.
+		for(l = first[i]; l != -1; l = next[l]) {
+			const struct w_lump *lump = W_LumpForId(spritelumps[l]);
 
-			if(*(uint32_t *)lump->name == intname) {
-				frame    = lump->name[4] - 'A';
-				rotation = lump->name[5] - '0';
+			frame    = lump->name[4] - 'A';
+			rotation = lump->name[5] - '0';
+			R_InstallSpriteLump(l, frame, rotation, false);
 
-				if(modifiedgame)
-					patched = W_GetIdForName(lump->name);
-				else
-					patched = id;
-
-				R_InstallSpriteLump(patched, frame, rotation, false);
-
-				if(lump->name[6]) {
-					frame    = lump->name[6] - 'A';
-					rotation = lump->name[7] - '0';
-					R_InstallSpriteLump(id, frame, rotation, true);
-				}
+			if(lump->name[6]) {
+				frame    = lump->name[6] - 'A';
+				rotation = lump->name[7] - '0';
+				R_InstallSpriteLump(l, frame, rotation, true);
 			}
 		}
 
@@ -251,6 +279,8 @@ R_InitSpriteDefs(const char **namelist) {
 		sprites[i].spriteframes = Z_Malloc(maxframe * sizeof(spriteframe_t), PU_STATIC, NULL);
 		memcpy(sprites[i].spriteframes, sprtemp, maxframe * sizeof(spriteframe_t));
 	}
+
+	Z_ScratchRelease(&framescratch, mark);
 }
 
 //
@@ -360,7 +390,7 @@ R_DrawVisSprite(vissprite_t *vis,
 	fixed_t frac;
 	const patch_t *patch;
 
-	patch = W_LumpForId(vis->patch + firstspritelump)->data;
+	patch = W_LumpForId(spritelumps[vis->patch])->data;
 
 	dc_colormap = vis->colormap;
 
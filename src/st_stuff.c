@@ -494,6 +494,17 @@ unsigned char cheat_mypos_seq[] = {
 	0xff // idmypos
 };
 
+// zone statistics cheat
+unsigned char cheat_zone_seq[] = {
+	0xb2,
+	0x26,
+	0x7a,
+	0xf6,
+	0x76,
+	0xa6,
+	0xff // idzone
+};
+
 // Now what?
 cheatseq_t cheat_mus               = { cheat_mus_seq, 0 };
 cheatseq_t cheat_god               = { cheat_god_seq, 0 };
@@ -515,6 +526,7 @@ cheatseq_t cheat_powerup[7] = {
 cheatseq_t cheat_choppers = { cheat_choppers_seq, 0 };
 cheatseq_t cheat_clev     = { cheat_clev_seq, 0 };
 cheatseq_t cheat_mypos    = { cheat_mypos_seq, 0 };
+cheatseq_t cheat_zone     = { cheat_zone_seq, 0 };
 
 //
 extern char *mapnames[];
@@ -673,6 +685,13 @@ ST_Responder(event_t *ev) {
 				sprintf(buf, "ang=0x%x;x,y=(0x%x,0x%x)", players[consoleplayer].mo->angle, players[consoleplayer].mo->x, players[consoleplayer].mo->y);
 				plyr->message = buf;
 			}
+			// 'zone' for memory statistics
+			else if(cht_CheckCheat(&cheat_zone, ev->data1)) {
+				static char buf[ST_MSGWIDTH];
+				Z_PrintStats();
+				sprintf(buf, "zone: %i KB free", Z_FreeMemory() >> 10);
+				plyr->message = buf;
+			}
 		}
 
 		// 'clev' change-level cheat
@@ -27,12 +27,22 @@
 
 #include "m_bbox.h"
 #include "m_swap.h"
+#include "z_zone.h"
 
 #include "v_video.h"
 
 // Each screen is [SCREENWIDTH*SCREENHEIGHT];
 byte *screens[5];
 
+// Overlay over screens[0], where overlaymask is set.
+byte *overlay;
+byte *overlaymask;
+int overlaytop;
+int overlaybottom;
+
+// Whether screen 0 draws go into the overlay.
+static boolean v_overlaying;
+
 int dirtybox[4];
 
 // Now where did these came from?
@@ -103,124 +113,283 @@ V_CopyRect(int srcx,
 }
 
 //
-// V_DrawPatch
-// Masks a column based masked pic to the screen.
+// Patches decoded once into native rows of opaque spans,
+//  so drawing is a memcpy per span, instead of walking the
+//  posts of the lump with byte swaps on each draw.
+// Decoded patches are PU_CACHE, and looked up by address.
 //
-void
-V_DrawPatch(int x,
-	int y,
-	int scrn,
-	const patch_t *patch) {
+typedef struct {
+	short x;
+	short length;
+	int offset; // in pixels
+} v_span_t;
+
+typedef struct {
+	int width;
+	int height;
+	int leftoffset;
+	int topoffset;
+	const int *rows; // height + 1 indices in spans
+	const v_span_t *spans;
+	const byte *pixels;
+} v_patch_t;
+
+#define V_PATCHSLOTS 2048
+
+static struct v_patchslot {
+	const patch_t *patch;
+	v_patch_t *decoded;
+} v_patches[V_PATCHSLOTS];
+
+static int v_numpatches;
 
-	int count;
+//
+// V_DecodePatch
+// Posts may go past the height of the patch,
+//  the decoded one is grown to include them.
+//
+static void
+V_DecodePatch(const patch_t *patch,
+	v_patch_t **user) {
+	const int width = SHORT(patch->width);
+	const column_t *column;
+	v_patch_t *vp;
+	v_span_t *spans;
+	int *rows;
+	byte *pixels;
+	byte *grid;
+	byte *opaque;
+	int numspans;
+	int numpixels;
+	int height;
 	int col;
-	column_t *column;
-	byte *desttop;
-	byte *dest;
-	byte *source;
-	int w;
+	int row;
+	int i;
 
-	y -= SHORT(patch->topoffset);
-	x -= SHORT(patch->leftoffset);
-#ifdef RANGECHECK
-	if(x < 0
-		|| x + SHORT(patch->width) > SCREENWIDTH
-		|| y < 0
-		|| y + SHORT(patch->height) > SCREENHEIGHT
-		|| (unsigned)scrn > 4) {
-		fprintf(stderr, "Patch at %d,%d exceeds LFB\n", x, y);
-		// No I_Error abort - what is up with TNT.WAD?
-		fprintf(stderr, "V_DrawPatch: bad patch (ignored)\n");
-		return;
+	height = SHORT(patch->height);
+	for(col = 0; col < width; col++) {
+		column = (const column_t *)((const byte *)patch + LONG(patch->columnofs[col]));
+		for(; column->topdelta != 0xff; column = (const column_t *)((const byte *)column + column->length + 4)) {
+			if(column->topdelta + column->length > height)
+				height = column->topdelta + column->length;
+		}
+	}
+
+	grid   = Z_Malloc(width * height * 2 + 1, PU_STATIC, 0);
+	opaque = grid + width * height;
+	memset(opaque, 0, width * height + 1);
+
+	for(col = 0; col < width; col++) {
+		column = (const column_t *)((const byte *)patch + LONG(patch->columnofs[col]));
+		for(; column->topdelta != 0xff; column = (const column_t *)((const byte *)column + column->length + 4)) {
+			for(i = 0; i < column->length; i++) {
+				grid[(column->topdelta + i) * width + col]   = ((const byte *)column)[3 + i];
+				opaque[(column->topdelta + i) * width + col] = 1;
+			}
+		}
 	}
-#endif
 
-	if(!scrn)
-		V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height));
+	numspans  = 0;
+	numpixels = 0;
+	for(i = 0; i < width * height; i++) {
+		if(opaque[i]) {
+			numpixels++;
+			// the sentinel ends the last row
+			if(i % width == width - 1 || !opaque[i + 1])
+				numspans++;
+		}
+	}
 
-	col     = 0;
-	desttop = screens[scrn] + y * SCREENWIDTH + x;
+	// spans after an even count of rows, to stay aligned
+	Z_Malloc(sizeof(*vp) + ((height + 2) & ~1) * sizeof(*rows)
+			+ numspans * sizeof(*spans) + numpixels,
+		PU_CACHE, (void **)user);
+	vp     = *user;
+	rows   = (int *)(vp + 1);
+	spans  = (v_span_t *)(rows + ((height + 2) & ~1));
+	pixels = (byte *)(spans + numspans);
+
+	vp->width      = width;
+	vp->height     = height;
+	vp->leftoffset = SHORT(patch->leftoffset);
+	vp->topoffset  = SHORT(patch->topoffset);
+	vp->rows       = rows;
+	vp->spans      = spans;
+	vp->pixels     = pixels;
+
+	numspans  = 0;
+	numpixels = 0;
+	for(row = 0; row < height; row++) {
+		const byte *gridrow   = grid + row * width;
+		const byte *opaquerow = opaque + row * width;
+
+		rows[row] = numspans;
+		for(col = 0; col < width;) {
+			if(!opaquerow[col]) {
+				col++;
+				continue;
+			}
 
-	w = SHORT(patch->width);
+			spans[numspans].x      = col;
+			spans[numspans].offset = numpixels;
+			while(col < width && opaquerow[col])
+				pixels[numpixels++] = gridrow[col++];
+			spans[numspans].length = numpixels - spans[numspans].offset;
+			numspans++;
+		}
+	}
+	rows[height] = numspans;
 
-	for(; col < w; x++, col++, desttop++) {
-		column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
+	Z_Free(grid);
+}
 
-		// step through the posts in a column
-		while(column->topdelta != 0xff) {
-			source = (byte *)column + 3;
-			dest   = desttop + column->topdelta * SCREENWIDTH;
-			count  = column->length;
+//
+// V_CachePatch
+// Decoded patch for a patch lump.
+//
+static const v_patch_t *
+V_CachePatch(const patch_t *patch) {
+	struct v_patchslot *slot;
+	unsigned index;
+	int i;
+
+	index = ((uintptr_t)patch >> 3) * 2654435761u % V_PATCHSLOTS;
+	for(slot = v_patches + index; slot->patch != NULL && slot->patch != patch;) {
+		if(++slot == v_patches + V_PATCHSLOTS)
+			slot = v_patches;
+	}
 
-			while(count--) {
-				*dest = *source++;
-				dest += SCREENWIDTH;
+	if(slot->patch == NULL) {
+		if(v_numpatches == V_PATCHSLOTS * 3 / 4) {
+			// Table full, start over.
+			for(i = 0; i < V_PATCHSLOTS; i++) {
+				if(v_patches[i].decoded != NULL)
+					Z_Free(v_patches[i].decoded);
+				v_patches[i].patch = NULL;
 			}
-			column = (column_t *)((byte *)column + column->length
-								  + 4);
+			v_numpatches = 0;
+			slot         = v_patches + index;
 		}
+		slot->patch = patch;
+		v_numpatches++;
 	}
+
+	if(slot->decoded == NULL)
+		V_DecodePatch(patch, &slot->decoded);
+
+	return slot->decoded;
 }
 
 //
-// V_DrawPatchFlipped
-// Masks a column based masked pic to the screen.
-// Flips horizontally, e.g. to mirror face.
+// V_BlitPatch
+// Clips a decoded patch to the screen
+//  while copying its spans.
 //
-void
-V_DrawPatchFlipped(int x,
+static void
+V_BlitPatch(int x,
 	int y,
 	int scrn,
-	const patch_t *patch) {
-
-	int count;
-	int col;
-	column_t *column;
-	byte *desttop;
+	const v_patch_t *vp,
+	boolean flipped) {
+	const v_span_t *span;
+	const v_span_t *end;
+	const byte *source;
+	byte *screen;
+	byte *mask;
 	byte *dest;
-	byte *source;
-	int w;
+	int row;
+	int rowend;
+	int x1;
+	int x2;
+	int i;
+
+	y -= vp->topoffset;
+	x -= vp->leftoffset;
 
-	y -= SHORT(patch->topoffset);
-	x -= SHORT(patch->leftoffset);
 #ifdef RANGECHECK
-	if(x < 0
-		|| x + SHORT(patch->width) > SCREENWIDTH
-		|| y < 0
-		|| y + SHORT(patch->height) > SCREENHEIGHT
-		|| (unsigned)scrn > 4) {
-		fprintf(stderr, "Patch origin %d,%d exceeds LFB\n", x, y);
-		I_Error("Bad V_DrawPatch in V_DrawPatchFlipped");
-	}
+	if((unsigned)scrn > 4)
+		I_Error("V_BlitPatch: bad screen %i", scrn);
 #endif
 
-	if(!scrn)
-		V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height));
+	row    = y < 0 ? -y : 0;
+	rowend = y + vp->height > SCREENHEIGHT ? SCREENHEIGHT - y : vp->height;
+
+	screen = screens[scrn];
+	mask   = NULL;
+	if(!scrn) {
+		if(v_overlaying && row < rowend) {
+			screen = overlay;
+			mask   = overlaymask;
+			if(overlaytop > y + row)
+				overlaytop = y + row;
+			if(overlaybottom < y + rowend)
+				overlaybottom = y + rowend;
+		} else
+			V_MarkRect(x, y, vp->width, vp->height);
+	}
 
-	col     = 0;
-	desttop = screens[scrn] + y * SCREENWIDTH + x;
+	for(; row < rowend; row++) {
+		dest = screen + (y + row) * SCREENWIDTH;
+		span = vp->spans + vp->rows[row];
+		end  = vp->spans + vp->rows[row + 1];
 
-	w = SHORT(patch->width);
+		for(; span != end; span++) {
+			source = vp->pixels + span->offset;
+			x1     = flipped ? x + vp->width - span->x - span->length : x + span->x;
+			x2     = x1 + span->length;
 
-	for(; col < w; x++, col++, desttop++) {
-		column = (column_t *)((byte *)patch + LONG(patch->columnofs[w - 1 - col]));
+			if(x1 < 0) {
+				if(!flipped)
+					source -= x1;
+				x1 = 0;
+			}
+			if(x2 > SCREENWIDTH) {
+				if(flipped)
+					source += x2 - SCREENWIDTH;
+				x2 = SCREENWIDTH;
+			}
+			if(x1 >= x2)
+				continue;
 
-		// step through the posts in a column
-		while(column->topdelta != 0xff) {
-			source = (byte *)column + 3;
-			dest   = desttop + column->topdelta * SCREENWIDTH;
-			count  = column->length;
+			if(mask)
+				memset(mask + (y + row) * SCREENWIDTH + x1, 0xff, x2 - x1);
 
-			while(count--) {
-				*dest = *source++;
-				dest += SCREENWIDTH;
+			if(!flipped) {
+				memcpy(dest + x1, source, x2 - x1);
+			} else {
+				for(i = x2 - 1; i >= x1; i--)
+					dest[i] = *source++;
 			}
-			column = (column_t *)((byte *)column + column->length
-								  + 4);
 		}
 	}
 }
 
+//
+// V_DrawPatch
+// Masks a column based masked pic to the screen.
+// Parts outside of the screen are clipped.
+//
+void
+V_DrawPatch(int x,
+	int y,
+	int scrn,
+	const patch_t *patch) {
+	V_BlitPatch(x, y, scrn, V_CachePatch(patch), false);
+}
+
+//
+// V_DrawPatchFlipped
+// Masks a column based masked pic to the screen.
+// Flips horizontally, e.g. to mirror face.
+//
+void
+V_DrawPatchFlipped(int x,
+	int y,
+	int scrn,
+	const patch_t *patch) {
+	V_BlitPatch(x, y, scrn, V_CachePatch(patch), true);
+}
+
 //
 // V_DrawPatchDirect
 // Draws directly to the screen on the pc.
@@ -351,6 +520,53 @@ V_GetBlock(int x,
 	}
 }
 
+//
+// V_BeginOverlay
+// Clears the overlay, patches drawn to
+//  screen 0 go into it until V_EndOverlay.
+//
+void
+V_BeginOverlay(void) {
+	if(overlaytop < overlaybottom)
+		memset(overlaymask + overlaytop * SCREENWIDTH, 0, (overlaybottom - overlaytop) * SCREENWIDTH);
+
+	overlaytop    = SCREENHEIGHT;
+	overlaybottom = 0;
+	v_overlaying  = true;
+}
+
+//
+// V_EndOverlay
+//
+void
+V_EndOverlay(void) {
+	v_overlaying = false;
+}
+
+//
+// V_ComposeOverlay
+// Copies the overlay over a screen, for
+//  anything reading back what is presented.
+//
+void
+V_ComposeOverlay(byte *scr) {
+	const byte *source;
+	const byte *mask;
+	byte *dest;
+	byte *end;
+
+	if(overlaytop >= overlaybottom)
+		return;
+
+	source = overlay + overlaytop * SCREENWIDTH;
+	mask   = overlaymask + overlaytop * SCREENWIDTH;
+	dest   = scr + overlaytop * SCREENWIDTH;
+	end    = scr + overlaybottom * SCREENWIDTH;
+
+	for(; dest != end; source++, mask++, dest++)
+		*dest = (*dest & ~*mask) | (*source & *mask);
+}
+
 //
 // V_Init
 //
@@ -361,8 +577,11 @@ V_Init(void) {
 
 	// stick these in low dos memory on PCs
 
-	base = I_AllocLow(SCREENWIDTH * SCREENHEIGHT * 4);
+	base = I_AllocLow(SCREENWIDTH * SCREENHEIGHT * 6);
 
 	for(i = 0; i < 4; i++)
 		screens[i] = base + i * SCREENWIDTH * SCREENHEIGHT;
+
+	overlay     = base + 4 * SCREENWIDTH * SCREENHEIGHT;
+	overlaymask = base + 5 * SCREENWIDTH * SCREENHEIGHT;
 }
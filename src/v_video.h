@@ -38,6 +38,15 @@
 
 extern byte *screens[5];
 
+// The overlay holds the HUD, pause pic and menus,
+// composited over screen 0 when presented, where
+// overlaymask is set, only within rows overlaytop
+// to overlaybottom (excluded).
+extern byte *overlay;
+extern byte *overlaymask;
+extern int overlaytop;
+extern int overlaybottom;
+
 extern int dirtybox[4];
 
 extern byte gammatable[5][256];
@@ -93,6 +102,18 @@ V_GetBlock(int x,
 	int height,
 	byte *dest);
 
+// Redraws the overlay, patches drawn to
+// screen 0 go into it until V_EndOverlay.
+void
+V_BeginOverlay(void);
+
+void
+V_EndOverlay(void);
+
+// Copies the overlay over a screen buffer.
+void
+V_ComposeOverlay(byte *scr);
+
 void
 V_MarkRect(int x,
 	int y,
@@ -25,6 +25,53 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+struct w_prefetch {
+	size_t count;
+	lumpId_t ids[];
+};
+
+/* Slot of a lump hash table, keyed by packed names */
+struct w_slot {
+	uint64_t key;
+	lumpId_t id; /* Last loaded lump with this name, -1 if empty */
+};
+
+struct w_table {
+	struct w_slot *slots;
+	size_t mask;
+};
+
+/* Lumps between the markers of a namespace, in every file,
+each name appears once, at the index of its first appearance */
+struct w_namespace {
+	lumpId_t *ids;
+	size_t count;
+	struct w_table names; /* Slots ids are indices in ids */
+};
+
+struct w_marker {
+	char name[8];
+	enum w_namespaceId namespace;
+	bool start;
+};
+
+static const struct w_marker markers[] = {
+	{ "F_START", W_NAMESPACE_FLATS, true },
+	{ "F_END", W_NAMESPACE_FLATS, false },
+	{ "FF_START", W_NAMESPACE_FLATS, true },
+	{ "FF_END", W_NAMESPACE_FLATS, false },
+	{ "S_START", W_NAMESPACE_SPRITES, true },
+	{ "S_END", W_NAMESPACE_SPRITES, false },
+	{ "SS_START", W_NAMESPACE_SPRITES, true },
+	{ "SS_END", W_NAMESPACE_SPRITES, false },
+	{ "P_START", W_NAMESPACE_PATCHES, true },
+	{ "P_END", W_NAMESPACE_PATCHES, false },
+	{ "PP_START", W_NAMESPACE_PATCHES, true },
+	{ "PP_END", W_NAMESPACE_PATCHES, false },
+};
 
 static struct w_wad {
 	struct i_fileMap *filemaps;
@@ -32,12 +79,57 @@ static struct w_wad {
 
 	struct w_lump *lumps;
 	size_t lumps_count;
+
+	struct w_table directory;
+	lumpId_t *previous; /* Previous lump with the same name, for each lump */
+	uint8_t *namespaces; /* Namespace of each lump, markers are global */
+	struct w_namespace namespace[W_NAMESPACE_COUNT];
+
+	pthread_t prefetcher;
+	bool prefetching;
 } w_wad;
 
+/* Packs a lump name case folded in a key, names
+are at most 8 characters long so none are lost */
+static uint64_t
+W_NameKey(const char *name) {
+	uint64_t key = 0;
+	unsigned int i;
+
+	for(i = 0; i < 8 && name[i] != '\0'; i++) {
+		const uint8_t c = name[i];
+
+		key |= (uint64_t)(c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c) << i * 8;
+	}
+
+	return key;
+}
+
 static void
 W_ReserveLumps(size_t count) {
 	w_wad.lumps_count += count;
 	w_wad.lumps = realloc(w_wad.lumps, w_wad.lumps_count * sizeof(*w_wad.lumps));
+	w_wad.namespaces = realloc(w_wad.namespaces, w_wad.lumps_count * sizeof(*w_wad.namespaces));
+
+	if(w_wad.lumps == NULL || w_wad.namespaces == NULL) {
+		I_Error("W_ReserveLumps: Unable to allocate %zu lumps", w_wad.lumps_count);
+	}
+}
+
+/* Returns the namespace a marker starts or ends, global if not a marker */
+static enum w_namespaceId
+W_Marker(const char *name, bool *start) {
+	const uint64_t key = W_NameKey(name);
+	size_t i;
+
+	for(i = 0; i < sizeof(markers) / sizeof(*markers); i++) {
+		if(W_NameKey(markers[i].name) == key) {
+			*start = markers[i].start;
+			return markers[i].namespace;
+		}
+	}
+
+	return W_NAMESPACE_GLOBAL;
 }
 
 static void
@@ -66,13 +158,31 @@ W_InitFile(const char *filename, struct i_fileMap *filemap) {
 		W_ReserveLumps(count);
 		struct w_lump * const lumpsend = w_wad.lumps + w_wad.lumps_count;
 		struct w_lump *lumps = lumpsend - count;
+		uint8_t *namespaces = w_wad.namespaces + w_wad.lumps_count - count;
+		enum w_namespaceId current = W_NAMESPACE_GLOBAL;
 
 		while(lumps != lumpsend) {
+			enum w_namespaceId marker;
+			bool start;
 
 			strncpy(lumps->name, lumpinfo->name, sizeof(lumps->name));
 			lumps->size = lumpinfo->size;
 			lumps->data = (const uint8_t *)filemap->address + lumpinfo->position;
 
+			/* Namespaces never span across files */
+			marker = W_Marker(lumps->name, &start);
+			if(marker != W_NAMESPACE_GLOBAL) {
+				if(start) {
+					current = marker;
+				} else if(marker == current) {
+					current = W_NAMESPACE_GLOBAL;
+				}
+				*namespaces = W_NAMESPACE_GLOBAL;
+			} else {
+				*namespaces = current;
+			}
+
+			namespaces++;
 			lumpinfo++;
 			lumps++;
 		}
@@ -83,15 +193,162 @@ W_InitFile(const char *filename, struct i_fileMap *filemap) {
 		strncpy(lump->name, filename, sizeof(lump->name));
 		lump->size = filemap->size;
 		lump->data = filemap->address;
+		w_wad.namespaces[w_wad.lumps_count - 1] = W_NAMESPACE_GLOBAL;
+	}
+}
+
+static void
+W_InitTable(struct w_table *table, size_t count) {
+	size_t capacity = 16;
+	size_t i;
+
+	while(capacity < count * 2) {
+		capacity *= 2;
+	}
+
+	table->slots = malloc(capacity * sizeof(*table->slots));
+	table->mask = capacity - 1;
+
+	if(table->slots == NULL) {
+		I_Error("W_InitTable: Unable to allocate table for %zu lumps", count);
+	}
+
+	for(i = 0; i < capacity; i++) {
+		table->slots[i].id = -1;
+	}
+}
+
+static struct w_slot *
+W_FindSlot(const struct w_table *table, uint64_t key) {
+	size_t i = (key * 0x9E3779B97F4A7C15ull) >> 32 & table->mask;
+
+	while(table->slots[i].id != -1 && table->slots[i].key != key) {
+		i = (i + 1) & table->mask;
+	}
+
+	return table->slots + i;
+}
+
+/* Merges the lumps of a namespace from every file, a name
+keeps its first index but resolves to its last loaded lump,
+either in the namespace or outside of any, like old PWADs do */
+static void
+W_InitNamespace(enum w_namespaceId id) {
+	struct w_namespace * const namespace = w_wad.namespace + id;
+	size_t count = 0;
+	size_t i;
+
+	for(i = 0; i < w_wad.lumps_count; i++) {
+		count += w_wad.namespaces[i] == id;
+	}
+
+	namespace->ids = malloc(count * sizeof(*namespace->ids));
+	namespace->count = 0;
+	W_InitTable(&namespace->names, count);
+
+	if(count != 0 && namespace->ids == NULL) {
+		I_Error("W_InitNamespace: Unable to allocate namespace for %zu lumps", count);
+	}
+
+	for(i = 0; i < w_wad.lumps_count; i++) {
+		if(w_wad.namespaces[i] == id) {
+			const uint64_t key = W_NameKey(w_wad.lumps[i].name);
+			struct w_slot * const slot = W_FindSlot(&namespace->names, key);
+
+			if(slot->id == -1) {
+				slot->key = key;
+				slot->id = namespace->count++;
+			}
+		}
+	}
+
+	for(i = 0; i < namespace->names.mask + 1; i++) {
+		const struct w_slot * const slot = namespace->names.slots + i;
+
+		if(slot->id != -1) {
+			lumpId_t lump = W_FindSlot(&w_wad.directory, slot->key)->id;
+
+			while(w_wad.namespaces[lump] != id && w_wad.namespaces[lump] != W_NAMESPACE_GLOBAL) {
+				lump = w_wad.previous[lump];
+			}
+
+			namespace->ids[slot->id] = lump;
+		}
+	}
+}
+
+/* Hashes the whole directory, loading order is kept so
+the last loaded lump wins, like the previous backward scan */
+static void
+W_InitDirectory(void) {
+	size_t i;
+
+	W_InitTable(&w_wad.directory, w_wad.lumps_count);
+	w_wad.previous = malloc(w_wad.lumps_count * sizeof(*w_wad.previous));
+
+	if(w_wad.previous == NULL) {
+		I_Error("W_InitDirectory: Unable to allocate directory for %zu lumps", w_wad.lumps_count);
+	}
+
+	for(i = 0; i < w_wad.lumps_count; i++) {
+		const uint64_t key = W_NameKey(w_wad.lumps[i].name);
+		struct w_slot * const slot = W_FindSlot(&w_wad.directory, key);
+
+		w_wad.previous[i] = slot->id;
+		slot->key = key;
+		slot->id = i;
+	}
+
+	for(i = W_NAMESPACE_GLOBAL + 1; i < W_NAMESPACE_COUNT; i++) {
+		W_InitNamespace(i);
+	}
+}
+
+static void *
+W_PrefetchMain(void *arg) {
+	struct w_prefetch * const prefetch = arg;
+	size_t i;
+
+	/* Queue every read first, so the kernel can merge and overlap them */
+	for(i = 0; i < prefetch->count; i++) {
+		const struct w_lump * const lump = w_wad.lumps + prefetch->ids[i];
+		I_FileAdvise(lump->data, lump->size);
+	}
+
+	for(i = 0; i < prefetch->count; i++) {
+		const struct w_lump * const lump = w_wad.lumps + prefetch->ids[i];
+		I_FileTouch(lump->data, lump->size);
+	}
+
+	free(prefetch);
+
+	return NULL;
+}
+
+static void
+W_PrefetchWait(void) {
+	if(w_wad.prefetching) {
+		pthread_join(w_wad.prefetcher, NULL);
+		w_wad.prefetching = false;
 	}
 }
 
 static void
 W_Shutdown(void) {
+	/* Mappings must outlive the prefetcher */
+	W_PrefetchWait();
+
 	while(w_wad.filemaps_count-- != 0) {
 		I_FileUnMap(w_wad.filemaps + w_wad.filemaps_count);
 	}
 	free(w_wad.filemaps);
+	for(size_t i = W_NAMESPACE_GLOBAL + 1; i < W_NAMESPACE_COUNT; i++) {
+		free(w_wad.namespace[i].names.slots);
+		free(w_wad.namespace[i].ids);
+	}
+	free(w_wad.namespaces);
+	free(w_wad.previous);
+	free(w_wad.directory.slots);
 	free(w_wad.lumps);
 }
 
@@ -99,6 +356,7 @@ void
 W_Init(const char * const *files) {
 
 	if(*files != NULL) {
+		const char * const *filesbegin = files;
 		const char * const *filesend = files;
 
 		while(*++filesend != NULL);
@@ -112,7 +370,7 @@ W_Init(const char * const *files) {
 
 		while(files != filesend) {
 
-			W_InitFile(*files, filesend - files + w_wad.filemaps);
+			W_InitFile(*files, w_wad.filemaps + (files - filesbegin));
 
 			files++;
 		}
@@ -120,20 +378,23 @@ W_Init(const char * const *files) {
 		I_Error("W_Init: No files found");
 	}
 
+	W_InitDirectory();
+
 	atexit(W_Shutdown);
 }
 
 lumpId_t
 W_FindIdForName(const char *name) {
-	const struct w_lump *lumpsend = w_wad.lumps + w_wad.lumps_count;
+	return W_FindSlot(&w_wad.directory, W_NameKey(name))->id;
+}
 
-	while(--lumpsend >= w_wad.lumps) {
-		if(strncasecmp(lumpsend->name, name, sizeof(lumpsend->name)) == 0) {
-			return lumpsend - w_wad.lumps;
-		}
+lumpId_t
+W_FindPreviousId(lumpId_t id) {
+	if(id < 0 || id >= w_wad.lumps_count) {
+		I_Error("W_FindPreviousId: Invalid lump id '%d'", id);
 	}
 
-	return -1;
+	return w_wad.previous[id];
 }
 
 lumpId_t
@@ -147,6 +408,26 @@ W_GetIdForName(const char *name) {
 	return id;
 }
 
+const lumpId_t *
+W_NamespaceIds(enum w_namespaceId id, size_t *count) {
+	if(id <= W_NAMESPACE_GLOBAL || id >= W_NAMESPACE_COUNT) {
+		I_Error("W_NamespaceIds: Invalid namespace '%d'", id);
+	}
+
+	*count = w_wad.namespace[id].count;
+
+	return w_wad.namespace[id].ids;
+}
+
+int
+W_FindNamespaceIndex(enum w_namespaceId id, const char *name) {
+	if(id <= W_NAMESPACE_GLOBAL || id >= W_NAMESPACE_COUNT) {
+		I_Error("W_FindNamespaceIndex: Invalid namespace '%d'", id);
+	}
+
+	return W_FindSlot(&w_wad.namespace[id].names, W_NameKey(name))->id;
+}
+
 const struct w_lump *
 W_LumpForId(lumpId_t id) {
 	if(id < 0 || id >= w_wad.lumps_count) {
@@ -166,3 +447,44 @@ W_LumpForName(const char *name) {
 
 	return w_wad.lumps + id;
 }
+
+const struct w_lump *
+W_LumpForHandle(struct w_handle *handle) {
+	if(handle->lump == NULL) {
+		handle->lump = W_LumpForName(handle->name);
+	}
+
+	return handle->lump;
+}
+
+void
+W_Prefetch(const lumpId_t *ids, size_t count) {
+	struct w_prefetch *prefetch;
+	size_t i;
+
+	W_PrefetchWait();
+
+	prefetch = malloc(sizeof(*prefetch) + count * sizeof(*prefetch->ids));
+	if(prefetch == NULL) {
+		return;
+	}
+
+	for(i = 0; i < count; i++) {
+		if(ids[i] < 0 || ids[i] >= w_wad.lumps_count) {
+			I_Error("W_Prefetch: Invalid lump id '%d'", ids[i]);
+		}
+		prefetch->ids[i] = ids[i];
+	}
+	prefetch->count = count;
+
+	if(pthread_create(&w_wad.prefetcher, NULL, W_PrefetchMain, prefetch) != 0) {
+		/* No thread, at least let the kernel read ahead */
+		for(i = 0; i < count; i++) {
+			I_FileAdvise(w_wad.lumps[ids[i]].data, w_wad.lumps[ids[i]].size);
+		}
+		free(prefetch);
+		return;
+	}
+
+	w_wad.prefetching = true;
+}
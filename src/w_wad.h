@@ -64,6 +64,24 @@ struct w_lump {
 
 typedef int32_t lumpId_t; /* Id used for loaded lumps */
 
+/* Lumps between X_START and X_END (or XX_START and XX_END) markers */
+enum w_namespaceId {
+	W_NAMESPACE_GLOBAL, /* Outside of any markers */
+	W_NAMESPACE_FLATS,
+	W_NAMESPACE_SPRITES,
+	W_NAMESPACE_PATCHES,
+	W_NAMESPACE_COUNT
+};
+
+/* Lump name resolved on its first use only, for the graphics
+drawn every frame, so drawing never looks up the directory */
+struct w_handle {
+	const char *name;          /* Name of the lump, kept as is */
+	const struct w_lump *lump; /* Lump once resolved */
+};
+
+#define W_HANDLE(name) { (name), NULL }
+
 /* Load WAD files and choose lumps according to array order */
 void
 W_Init(const char * const *files);
@@ -72,10 +90,24 @@ W_Init(const char * const *files);
 lumpId_t
 W_FindIdForName(const char *name);
 
+/* Looks up the lump loaded before id with the same name,
+returns -1 if none, to iterate over overridden lumps */
+lumpId_t
+W_FindPreviousId(lumpId_t id);
+
 /* Looks up lump id for name, fails if missing */
 lumpId_t
 W_GetIdForName(const char *name);
 
+/* Lump ids of a namespace, merged across all files, a lump
+overridden by a later file keeps the index of the first one */
+const lumpId_t *
+W_NamespaceIds(enum w_namespaceId id, size_t *count);
+
+/* Looks up the index in the namespace of name, returns -1 if missing */
+int
+W_FindNamespaceIndex(enum w_namespaceId id, const char *name);
+
 /* Finds lump for id, fails if invalid id */
 const struct w_lump *
 W_LumpForId(lumpId_t id);
@@ -84,4 +116,13 @@ W_LumpForId(lumpId_t id);
 const struct w_lump *
 W_LumpForName(const char *name);
 
+/* Finds lump for handle, fails if invalid name */
+const struct w_lump *
+W_LumpForHandle(struct w_handle *handle);
+
+/* Pages in the data of the lumps from a background thread,
+the previous prefetch is waited for, ids are copied */
+void
+W_Prefetch(const lumpId_t *ids, size_t count);
+
 #endif
@@ -18,6 +18,7 @@
 //-----------------------------------------------------------------------------
 
 #include <stdint.h>
+#include <string.h>
 
 #include "z_zone.h"
 #include "i_system.h"
@@ -28,7 +29,11 @@
 //
 // There is never any space between memblocks,
 //  and there will never be two contiguous free memblocks.
-// The rover can be left pointing at a non-empty block.
+// Free blocks are kept in segregated lists per size class,
+//  found through a two level bitmap (as in TLSF),
+//  so allocating never walks the block list.
+// Purgable blocks are kept from the least recently tagged
+//  to the most, and purged in that order when nothing fits.
 //
 // It is of no value to free a cachable block,
 //  because it will get overwritten automatically if needed.
@@ -36,6 +41,37 @@
 
 #define ZONEID 0x1d4a11
 
+// Block sizes are kept pointer aligned.
+#define ZONEALIGN sizeof(void *)
+
+// Sizes below ZONESMALL are split linearly in ZONESLCOUNT classes,
+//  each power of two above is split in ZONESLCOUNT classes.
+#define ZONESLLOG2 3
+#define ZONESLCOUNT (1 << ZONESLLOG2)
+#define ZONESMALLLOG2 7
+#define ZONESMALL (1 << ZONESMALLLOG2)
+#define ZONEFLCOUNT (32 - ZONESMALLLOG2 + 1)
+
+// Grown segments are mapped in multiples of this.
+#define ZONESEGMENT (4 * 1024 * 1024)
+
+// Size of framescratch.
+#define ZONESCRATCH (1024 * 1024)
+
+// Segments of the zone are closed by a fence, a used block
+//  nothing merges with, and not touching the next block.
+#define Z_ISFENCE(block) ((block)->user == (void **)mainzone)
+
+typedef struct memsegment_s {
+	// mapped bytes, including this header
+	int size;
+
+	// last block of the segment
+	memblock_t *fence;
+
+	struct memsegment_s *next;
+} memsegment_t;
+
 typedef struct
 {
 	// total bytes malloced, including header
@@ -44,32 +80,297 @@ typedef struct
 	// start / end cap for linked list
 	memblock_t blocklist;
 
-	memblock_t *rover;
+	// start / end cap for the purge order
+	memblock_t purgelist;
+
+	// non empty free lists, first and second level
+	unsigned flbitmap;
+	unsigned slbitmap[ZONEFLCOUNT];
+
+	memblock_t *freelists[ZONEFLCOUNT][ZONESLCOUNT];
+
+	// segments grown past the initial zone
+	memsegment_t *segments;
 
 } memzone_t;
 
 memzone_t *mainzone;
 
+// Tags statistics are kept for, others share the last entry.
+#define ZONETAGS 8
+static const int zonetags[ZONETAGS - 1] = {
+	PU_STATIC, PU_SOUND, PU_MUSIC, PU_DAVE, PU_LEVEL, PU_LEVSPEC, PU_CACHE
+};
+static const char * const zonetagnames[ZONETAGS] = {
+	"static", "sound", "music", "dave", "level", "levspec", "cache", "other"
+};
+
+// Z_Malloc durations, entry i counts those under 2^i us.
+#define ZONELATENCIES 16
+
+// Kept up to date by each operation, see Z_PrintStats.
+// High water marks are since the last report.
+static struct z_stats {
+	int tagbytes[ZONETAGS];
+	int tagblocks[ZONETAGS];
+	int taghigh[ZONETAGS];
+	int usedbytes;
+	int usedhigh;
+	int purgablebytes;
+	int freebytes;
+	long mallocs;
+	long purges;
+	long purgedbytes;
+	int grows;
+	int releases;
+	long latencies[ZONELATENCIES];
+} z_stats;
+
+// Zone size past which growing is reported, and
+//  size never grown past, in MB, zero for no limit.
+int zonesoftmb = 64;
+int zonemaxmb  = 512;
+
+// Pools owning slabs, emptied by Z_FreeTags.
+static zpool_t *zonepools;
+
 //
-// Z_ClearZone
+// Z_SizeClass
+// Maps a block size to its free list.
 //
-void
-Z_ClearZone(memzone_t *zone) {
+static inline void
+Z_SizeClass(int size,
+	int *fl,
+	int *sl) {
+	int log2;
+
+	if(size < ZONESMALL) {
+		*fl = 0;
+		*sl = size / (ZONESMALL / ZONESLCOUNT);
+	} else {
+		log2 = 31 - __builtin_clz(size);
+		*fl  = log2 - ZONESMALLLOG2 + 1;
+		*sl  = (size >> (log2 - ZONESLLOG2)) & (ZONESLCOUNT - 1);
+	}
+}
+
+//
+// Z_CountBlock
+// Adds (count 1) or removes (count -1) a block
+//  to the statistics of its tag.
+//
+static void
+Z_CountBlock(const memblock_t *block,
+	int count) {
+	int bytes;
+	int i;
+
+	for(i = 0; i < ZONETAGS - 1 && zonetags[i] != block->tag; i++)
+		;
+
+	bytes = count * block->size;
+	z_stats.tagbytes[i] += bytes;
+	z_stats.tagblocks[i] += count;
+	z_stats.usedbytes += bytes;
+	if(block->tag >= PU_PURGELEVEL)
+		z_stats.purgablebytes += bytes;
+
+	if(z_stats.taghigh[i] < z_stats.tagbytes[i])
+		z_stats.taghigh[i] = z_stats.tagbytes[i];
+	if(z_stats.usedhigh < z_stats.usedbytes)
+		z_stats.usedhigh = z_stats.usedbytes;
+}
+
+//
+// Z_LinkFree
+//
+static void
+Z_LinkFree(memblock_t *block) {
+	memblock_t **head;
+	int fl;
+	int sl;
+
+	Z_SizeClass(block->size, &fl, &sl);
+	head = &mainzone->freelists[fl][sl];
+
+	block->lprev = NULL;
+	block->lnext = *head;
+	if(*head)
+		(*head)->lprev = block;
+	*head = block;
+
+	mainzone->flbitmap |= 1u << fl;
+	mainzone->slbitmap[fl] |= 1u << sl;
+
+	z_stats.freebytes += block->size;
+}
+
+//
+// Z_UnlinkFree
+//
+static void
+Z_UnlinkFree(memblock_t *block) {
+	memblock_t **head;
+	int fl;
+	int sl;
+
+	Z_SizeClass(block->size, &fl, &sl);
+	head = &mainzone->freelists[fl][sl];
+
+	if(block->lprev)
+		block->lprev->lnext = block->lnext;
+	else
+		*head = block->lnext;
+	if(block->lnext)
+		block->lnext->lprev = block->lprev;
+
+	if(!*head) {
+		mainzone->slbitmap[fl] &= ~(1u << sl);
+		if(!mainzone->slbitmap[fl])
+			mainzone->flbitmap &= ~(1u << fl);
+	}
+
+	z_stats.freebytes -= block->size;
+}
+
+//
+// Z_LinkPurge
+// Purgable blocks are appended, the oldest is purged first.
+//
+static void
+Z_LinkPurge(memblock_t *block) {
+	block->lnext        = &mainzone->purgelist;
+	block->lprev        = mainzone->purgelist.lprev;
+	block->lprev->lnext = block;
+	block->lnext->lprev = block;
+}
+
+//
+// Z_UnlinkPurge
+//
+static void
+Z_UnlinkPurge(memblock_t *block) {
+	block->lprev->lnext = block->lnext;
+	block->lnext->lprev = block->lprev;
+}
+
+//
+// Z_FindFree
+// Returns a free block of at least size bytes, or NULL.
+// Good fit in constant time, the size is rounded up to
+//  the next class, so any block of that class fits.
+// Falls back to searching the size class itself.
+//
+static memblock_t *
+Z_FindFree(int size) {
 	memblock_t *block;
+	unsigned bitmap;
+	int rounded;
+	int fl;
+	int sl;
+
+	if(size < ZONESMALL)
+		rounded = size + ZONESMALL / ZONESLCOUNT - 1;
+	else
+		rounded = size + (1 << (31 - __builtin_clz(size) - ZONESLLOG2)) - 1;
+
+	Z_SizeClass(rounded, &fl, &sl);
+
+	if(fl < ZONEFLCOUNT) {
+		bitmap = mainzone->slbitmap[fl] & (~0u << sl);
+		if(!bitmap && fl + 1 < ZONEFLCOUNT) {
+			bitmap = mainzone->flbitmap & (~0u << (fl + 1));
+			if(bitmap) {
+				fl     = __builtin_ctz(bitmap);
+				bitmap = mainzone->slbitmap[fl];
+			}
+		}
 
-	// set the entire zone to one free block
-	zone->blocklist.next = zone->blocklist.prev = block = (memblock_t *)((byte *)zone + sizeof(memzone_t));
+		if(bitmap)
+			return mainzone->freelists[fl][__builtin_ctz(bitmap)];
+	}
 
-	zone->blocklist.user = (void *)zone;
-	zone->blocklist.tag  = PU_STATIC;
-	zone->rover          = block;
+	Z_SizeClass(size, &fl, &sl);
+	for(block = mainzone->freelists[fl][sl]; block; block = block->lnext) {
+		if(block->size >= size)
+			return block;
+	}
+
+	return NULL;
+}
+
+//
+// Z_AddSpace
+// Appends size bytes at base to the end
+//  of the zone, as a free block and a fence.
+//
+static void
+Z_AddSpace(byte *base,
+	int size) {
+	memblock_t *block;
+	memblock_t *fence;
 
-	block->prev = block->next = &zone->blocklist;
+	block = (memblock_t *)base;
+	fence = (memblock_t *)(base + (size & ~(ZONEALIGN - 1)) - sizeof(memblock_t));
 
 	// NULL indicates a free block.
+	block->size = (byte *)fence - base;
 	block->user = NULL;
+	block->tag  = 0;
+	block->id   = 0;
+
+	fence->size = sizeof(memblock_t);
+	fence->user = (void **)mainzone;
+	fence->tag  = 0;
+	fence->id   = 0;
 
-	block->size = zone->size - sizeof(memzone_t);
+	block->prev = mainzone->blocklist.prev;
+	block->next = fence;
+	fence->prev = block;
+	fence->next = &mainzone->blocklist;
+
+	block->prev->next        = block;
+	mainzone->blocklist.prev = fence;
+
+	Z_LinkFree(block);
+}
+
+//
+// Z_Grow
+// Maps a new segment of at least size bytes,
+//  returns false if the limit would be exceeded.
+//
+static boolean
+Z_Grow(int size) {
+	memsegment_t *segment;
+	int64_t soft;
+	int segsize;
+
+	// room for the header, fence and alignment
+	size += sizeof(memsegment_t) + sizeof(memblock_t) + ZONEALIGN;
+	segsize = (size + ZONESEGMENT - 1) & ~(ZONESEGMENT - 1);
+
+	if(zonemaxmb > 0 && (int64_t)mainzone->size + segsize > (int64_t)zonemaxmb * 1024 * 1024)
+		return false;
+
+	segment = (memsegment_t *)I_ZoneGrow(segsize);
+	if(segment == NULL)
+		return false;
+
+	soft = (int64_t)zonesoftmb * 1024 * 1024;
+	if(zonesoftmb > 0 && mainzone->size <= soft && mainzone->size + segsize > soft)
+		printf("Z_Malloc: zone grew past %i MB\n", zonesoftmb);
+
+	segment->size      = segsize;
+	segment->next      = mainzone->segments;
+	mainzone->segments = segment;
+	mainzone->size += segsize;
+	z_stats.grows++;
+
+	Z_AddSpace((byte *)(segment + 1), segsize - sizeof(memsegment_t));
+	segment->fence = mainzone->blocklist.prev;
+
+	return true;
 }
 
 //
@@ -77,25 +378,23 @@ Z_ClearZone(memzone_t *zone) {
 //
 void
 Z_Init(void) {
-	memblock_t *block;
 	int size;
 
 	mainzone       = (memzone_t *)I_ZoneBase(&size);
+	memset(mainzone, 0, sizeof(memzone_t));
 	mainzone->size = size;
 
-	// set the entire zone to one free block
-	mainzone->blocklist.next = mainzone->blocklist.prev = block = (memblock_t *)((byte *)mainzone + sizeof(memzone_t));
+	mainzone->blocklist.next = mainzone->blocklist.prev = &mainzone->blocklist;
 
 	mainzone->blocklist.user = (void *)mainzone;
 	mainzone->blocklist.tag  = PU_STATIC;
-	mainzone->rover          = block;
 
-	block->prev = block->next = &mainzone->blocklist;
+	mainzone->purgelist.lnext = mainzone->purgelist.lprev = &mainzone->purgelist;
 
-	// NULL indicates a free block.
-	block->user = NULL;
+	// set the entire zone to one free block
+	Z_AddSpace((byte *)mainzone + sizeof(memzone_t), size - sizeof(memzone_t));
 
-	block->size = mainzone->size - sizeof(memzone_t);
+	Z_ScratchInit(&framescratch, ZONESCRATCH);
 }
 
 //
@@ -119,6 +418,11 @@ Z_Free(void *ptr) {
 		*block->user = 0;
 	}
 
+	if(block->tag >= PU_PURGELEVEL)
+		Z_UnlinkPurge(block);
+
+	Z_CountBlock(block, -1);
+
 	// mark as free
 	block->user = NULL;
 	block->tag  = 0;
@@ -128,26 +432,24 @@ Z_Free(void *ptr) {
 
 	if(!other->user) {
 		// merge with previous free block
+		Z_UnlinkFree(other);
 		other->size += block->size;
 		other->next       = block->next;
 		other->next->prev = other;
 
-		if(block == mainzone->rover)
-			mainzone->rover = other;
-
 		block = other;
 	}
 
 	other = block->next;
 	if(!other->user) {
 		// merge the next free block onto the end
+		Z_UnlinkFree(other);
 		block->size += other->size;
 		block->next       = other->next;
 		block->next->prev = block;
-
-		if(other == mainzone->rover)
-			mainzone->rover = block;
 	}
+
+	Z_LinkFree(block);
 }
 
 //
@@ -160,55 +462,32 @@ void *
 Z_Malloc(int size,
 	int tag,
 	void *user) {
+	uint64_t start;
+	int elapsed;
+	int bucket;
 	int extra;
-	memblock_t *start;
-	memblock_t *rover;
 	memblock_t *newblock;
 	memblock_t *base;
 
-	size = (size + 3) & ~3;
+	start = I_GetTimeUS();
 
-	// scan through the block list,
-	// looking for the first free block
-	// of sufficient size,
-	// throwing out any purgable blocks along the way.
+	size = (size + ZONEALIGN - 1) & ~(ZONEALIGN - 1);
 
 	// account for size of block header
 	size += sizeof(memblock_t);
 
-	// if there is a free block behind the rover,
-	//  back up over them
-	base = mainzone->rover;
-
-	if(!base->prev->user)
-		base = base->prev;
-
-	rover = base;
-	start = base->prev;
-
-	do {
-		if(rover == start) {
-			// scanned all the way around the list
+	// purge the least recently tagged
+	// blocks until one fits, else grow
+	while(!(base = Z_FindFree(size))) {
+		if(mainzone->purgelist.lnext != &mainzone->purgelist) {
+			z_stats.purges++;
+			z_stats.purgedbytes += mainzone->purgelist.lnext->size;
+			Z_Free((byte *)mainzone->purgelist.lnext + sizeof(memblock_t));
+		} else if(!Z_Grow(size))
 			I_Error("Z_Malloc: failed on allocation of %i bytes", size);
-		}
+	}
 
-		if(rover->user) {
-			if(rover->tag < PU_PURGELEVEL) {
-				// hit a block that can't be purged,
-				//  so move base past it
-				base = rover = rover->next;
-			} else {
-				// free the rover block (adding the size to base)
-
-				// the rover can be the base block
-				base = base->prev;
-				Z_Free((byte *)rover + sizeof(memblock_t));
-				base  = base->next;
-				rover = base->next;
-			}
-		} else
-			rover = rover->next;
-	} while(base->user || base->size < size);
+	Z_UnlinkFree(base);
 
 	// found a block big enough
 	extra = base->size - size;
@@ -221,12 +500,15 @@ Z_Malloc(int size,
 		// NULL indicates free block.
 		newblock->user       = NULL;
 		newblock->tag        = 0;
+		newblock->id         = 0;
 		newblock->prev       = base;
 		newblock->next       = base->next;
 		newblock->next->prev = newblock;
 
 		base->next = newblock;
 		base->size = size;
+
+		Z_LinkFree(newblock);
 	}
 
 	if(user) {
@@ -242,28 +524,94 @@ Z_Malloc(int size,
 	}
 	base->tag = tag;
 
-	// next allocation will start looking here
-	mainzone->rover = base->next;
+	if(tag >= PU_PURGELEVEL)
+		Z_LinkPurge(base);
 
 	base->id = ZONEID;
 
+	Z_CountBlock(base, 1);
+
+	elapsed = I_GetTimeUS() - start;
+	bucket  = elapsed ? 32 - __builtin_clz(elapsed) : 0;
+	z_stats.mallocs++;
+	z_stats.latencies[bucket < ZONELATENCIES ? bucket : ZONELATENCIES - 1]++;
+
 	return (void *)((byte *)base + sizeof(memblock_t));
 }
 
+//
+// Z_ReleaseSegments
+// Unmaps grown segments left with only free
+//  and purgable blocks, purging the latter.
+//
+static void
+Z_ReleaseSegments(void) {
+	memsegment_t **segment;
+	memsegment_t *released;
+	memblock_t *first;
+	memblock_t *fence;
+	memblock_t *block;
+	memblock_t *next;
+
+	for(segment = &mainzone->segments; *segment;) {
+		first = (memblock_t *)(*segment + 1);
+		fence = (*segment)->fence;
+
+		for(block = first; block != fence; block = block->next) {
+			if(block->user && block->tag < PU_PURGELEVEL)
+				break;
+		}
+
+		if(block != fence) {
+			segment = &(*segment)->next;
+			continue;
+		}
+
+		for(block = first; block != fence; block = next) {
+			next = block->next;
+			if(!next->user)
+				next = next->next;
+
+			if(block->user) {
+				z_stats.purges++;
+				z_stats.purgedbytes += block->size;
+				Z_Free((byte *)block + sizeof(memblock_t));
+			}
+		}
+
+		// the segment is now a single free block
+		Z_UnlinkFree(first);
+		first->prev->next = fence->next;
+		fence->next->prev = first->prev;
+
+		released = *segment;
+		*segment = released->next;
+		mainzone->size -= released->size;
+		z_stats.releases++;
+
+		I_ZoneRelease((byte *)released, released->size);
+	}
+}
+
 //
 // Z_FreeTags
+// Also releases the segments it emptied.
 //
 void
 Z_FreeTags(int lowtag,
 	int hightag) {
 	memblock_t *block;
 	memblock_t *next;
+	zpool_t **pool;
 
 	for(block = mainzone->blocklist.next;
 		block != &mainzone->blocklist;
 		block = next) {
-		// get link before freeing
+		// get link before freeing,
+		// skipping a free block it would merge with
 		next = block->next;
+		if(!next->user)
+			next = next->next;
 
 		// free block?
 		if(!block->user)
@@ -272,6 +620,181 @@ Z_FreeTags(int lowtag,
 		if(block->tag >= lowtag && block->tag <= hightag)
 			Z_Free((byte *)block + sizeof(memblock_t));
 	}
+
+	// the slabs of these pools are gone
+	for(pool = &zonepools; *pool;) {
+		if((*pool)->tag >= lowtag && (*pool)->tag <= hightag) {
+			(*pool)->free  = NULL;
+			(*pool)->slabs = 0;
+			*pool          = (*pool)->next;
+		} else
+			pool = &(*pool)->next;
+	}
+
+	Z_ReleaseSegments();
+}
+
+//
+// SLAB POOLS
+// Each object is preceded by its slot header,
+//  the owning pool when in use, the next free slot else.
+//
+typedef struct zslot_s {
+	zpool_t *pool;
+	struct zslot_s *next;
+} zslot_t;
+
+//
+// Z_PoolSlotSize
+//
+static inline int
+Z_PoolSlotSize(const zpool_t *pool) {
+	return sizeof(zslot_t) + ((pool->size + ZONEALIGN - 1) & ~(ZONEALIGN - 1));
+}
+
+//
+// Z_PoolAlloc
+// Takes the most recently freed object,
+//  or threads a new slab in address order.
+//
+void *
+Z_PoolAlloc(zpool_t *pool) {
+	zslot_t *slot;
+	byte *slab;
+	int slotsize;
+	int i;
+
+	if(!pool->free) {
+		slotsize = Z_PoolSlotSize(pool);
+		slab     = Z_Malloc(slotsize * pool->count, pool->tag, NULL);
+
+		for(i = pool->count - 1; i >= 0; i--) {
+			slot       = (zslot_t *)(slab + i * slotsize);
+			slot->pool = NULL;
+			slot->next = pool->free;
+			pool->free = slot;
+		}
+
+		if(!pool->slabs++) {
+			pool->next = zonepools;
+			zonepools  = pool;
+		}
+	}
+
+	slot       = pool->free;
+	pool->free = slot->next;
+	slot->pool = pool;
+
+	return slot + 1;
+}
+
+//
+// Z_PoolFree
+//
+void
+Z_PoolFree(void *ptr) {
+	zslot_t *slot;
+	zpool_t *pool;
+
+	slot = (zslot_t *)ptr - 1;
+	pool = slot->pool;
+
+	if(!pool)
+		I_Error("Z_PoolFree: freed an object twice");
+
+	slot->pool = NULL;
+	slot->next = pool->free;
+	pool->free = slot;
+}
+
+//
+// Z_ArenaInit
+// Size is the sum of the Z_ARENASIZE of all allocations.
+//
+void
+Z_ArenaInit(zarena_t *arena,
+	int size,
+	int tag) {
+	Z_Malloc(size + Z_ARENAALIGN - 1, tag, &arena->block);
+
+	arena->base = (byte *)Z_ARENASIZE((uintptr_t)arena->block);
+	arena->size = size;
+	arena->used = 0;
+}
+
+//
+// Z_ArenaAlloc
+//
+void *
+Z_ArenaAlloc(zarena_t *arena,
+	int size) {
+	void *ptr;
+
+	size = Z_ARENASIZE(size);
+
+	if(arena->block == NULL || arena->used + size > arena->size)
+		I_Error("Z_ArenaAlloc: failed on allocation of %i bytes", size);
+
+	ptr = arena->base + arena->used;
+	arena->used += size;
+
+	return ptr;
+}
+
+zscratch_t framescratch;
+
+//
+// Z_ScratchInit
+// Main thread only, the block lives as long as the program.
+//
+void
+Z_ScratchInit(zscratch_t *scratch,
+	int size) {
+	void *block;
+
+	size  = Z_ARENASIZE(size);
+	block = Z_Malloc(size + Z_ARENAALIGN - 1, PU_STATIC, NULL);
+
+	scratch->base = (byte *)Z_ARENASIZE((uintptr_t)block);
+	scratch->size = size;
+	scratch->used = 0;
+}
+
+//
+// Z_ScratchAlloc
+// Safe to call from any thread, never blocks.
+//
+void *
+Z_ScratchAlloc(zscratch_t *scratch,
+	int size) {
+	int offset;
+
+	size   = Z_ARENASIZE(size);
+	offset = __atomic_fetch_add(&scratch->used, size, __ATOMIC_RELAXED);
+
+	if(offset + size > scratch->size)
+		I_Error("Z_ScratchAlloc: failed on allocation of %i bytes", size);
+
+	return scratch->base + offset;
+}
+
+//
+// Z_ScratchMark
+//
+int
+Z_ScratchMark(zscratch_t *scratch) {
+	return __atomic_load_n(&scratch->used, __ATOMIC_RELAXED);
+}
+
+//
+// Z_ScratchRelease
+// Gives back everything allocated since the mark,
+//  no other thread may be allocating from it.
+//
+void
+Z_ScratchRelease(zscratch_t *scratch,
+	int mark) {
+	__atomic_store_n(&scratch->used, mark, __ATOMIC_RELAXED);
 }
 
 //
@@ -304,7 +827,7 @@ Z_DumpHeap(int lowtag,
 			break;
 		}
 
-		if((byte *)block + block->size != (byte *)block->next)
+		if(!Z_ISFENCE(block) && (byte *)block + block->size != (byte *)block->next)
 			printf("ERROR: block size does not touch the next block\n");
 
 		if(block->next->prev != block)
@@ -332,7 +855,7 @@ Z_FileDumpHeap(FILE *f) {
 			break;
 		}
 
-		if((byte *)block + block->size != (byte *)block->next)
+		if(!Z_ISFENCE(block) && (byte *)block + block->size != (byte *)block->next)
 			fprintf(f, "ERROR: block size does not touch the next block\n");
 
 		if(block->next->prev != block)
@@ -356,7 +879,7 @@ Z_CheckHeap(void) {
 			break;
 		}
 
-		if((byte *)block + block->size != (byte *)block->next)
+		if(!Z_ISFENCE(block) && (byte *)block + block->size != (byte *)block->next)
 			I_Error("Z_CheckHeap: block size does not touch the next block\n");
 
 		if(block->next->prev != block)
@@ -383,7 +906,15 @@ Z_ChangeTag2(void *ptr,
 	if(tag >= PU_PURGELEVEL && (uintptr_t)block->user < 0x100)
 		I_Error("Z_ChangeTag: an owner is required for purgable blocks");
 
+	// purgable again is more recent
+	if(block->tag >= PU_PURGELEVEL)
+		Z_UnlinkPurge(block);
+	if(tag >= PU_PURGELEVEL)
+		Z_LinkPurge(block);
+
+	Z_CountBlock(block, -1);
 	block->tag = tag;
+	Z_CountBlock(block, 1);
 }
 
 //
@@ -391,16 +922,74 @@ Z_ChangeTag2(void *ptr,
 //
 int
 Z_FreeMemory(void) {
-	memblock_t *block;
-	int free;
+	return z_stats.freebytes + z_stats.purgablebytes;
+}
 
-	free = 0;
+//
+// Z_LargestFree
+// Only searches the highest non empty size class.
+//
+static int
+Z_LargestFree(void) {
+	const memblock_t *block;
+	int largest;
+	int fl;
+	int sl;
+
+	if(!mainzone->flbitmap)
+		return 0;
+
+	fl = 31 - __builtin_clz(mainzone->flbitmap);
+	sl = 31 - __builtin_clz(mainzone->slbitmap[fl]);
+
+	largest = 0;
+	for(block = mainzone->freelists[fl][sl]; block; block = block->lnext) {
+		if(largest < block->size)
+			largest = block->size;
+	}
 
-	for(block = mainzone->blocklist.next;
-		block != &mainzone->blocklist;
-		block = block->next) {
-		if(!block->user || block->tag >= PU_PURGELEVEL)
-			free += block->size;
+	return largest;
+}
+
+//
+// Z_PrintStats
+// Reports the statistics, and starts
+//  new high water marks from there.
+//
+void
+Z_PrintStats(void) {
+	const memsegment_t *segment;
+	int segments;
+	int largest;
+	int i;
+
+	segments = 1;
+	for(segment = mainzone->segments; segment; segment = segment->next)
+		segments++;
+
+	largest = Z_LargestFree();
+
+	printf("Z_PrintStats: %i KB in %i segments, %i KB used, %i KB at most\n",
+		mainzone->size >> 10, segments,
+		z_stats.usedbytes >> 10, z_stats.usedhigh >> 10);
+	for(i = 0; i < ZONETAGS; i++) {
+		if(z_stats.taghigh[i])
+			printf(" %-8s %7i blocks %7i KB, %7i KB at most\n", zonetagnames[i],
+				z_stats.tagblocks[i], z_stats.tagbytes[i] >> 10, z_stats.taghigh[i] >> 10);
+	}
+	printf(" free: %i KB, largest %i KB, %i%% fragmented\n",
+		z_stats.freebytes >> 10, largest >> 10,
+		z_stats.freebytes ? 100 - (int)((int64_t)largest * 100 / z_stats.freebytes) : 0);
+	printf(" purged %li blocks, %li KB, grown %i times, released %i times\n",
+		z_stats.purges, z_stats.purgedbytes >> 10, z_stats.grows, z_stats.releases);
+	printf(" %li mallocs, by duration:", z_stats.mallocs);
+	for(i = 0; i < ZONELATENCIES; i++) {
+		if(z_stats.latencies[i])
+			printf(" <%ius %li", 1 << i, z_stats.latencies[i]);
 	}
-	return free;
+	putchar('\n');
+
+	z_stats.usedhigh = z_stats.usedbytes;
+	for(i = 0; i < ZONETAGS; i++)
+		z_stats.taghigh[i] = z_stats.tagbytes[i];
 }
@@ -23,6 +23,8 @@
 
 #include <stdio.h>
 
+#include "doomtype.h"
+
 //
 // ZONE MEMORY
 // PU - purge tags.
@@ -37,6 +39,10 @@
 #define PU_PURGELEVEL 100
 #define PU_CACHE 101
 
+// Growth limits of the zone, in MB.
+extern int zonesoftmb;
+extern int zonemaxmb;
+
 void
 Z_Init(void);
 void *
@@ -55,6 +61,74 @@ void
 Z_ChangeTag2(void *ptr, int tag);
 int
 Z_FreeMemory(void);
+void
+Z_PrintStats(void);
+
+//
+// SLAB POOLS
+// Fixed size objects carved from tagged zone blocks,
+// kept contiguous and recycled through a free list.
+// Freeing the pool's tag with Z_FreeTags empties it.
+//
+typedef struct zpool_s {
+	int size;  // of an object
+	int count; // objects per slab
+	int tag;   // of the slabs
+	struct zslot_s *free;
+	struct zpool_s *next; // pools with slabs
+	int slabs;            // currently allocated
+} zpool_t;
+
+#define Z_POOL(type, count, tag) { sizeof(type), (count), (tag), NULL, NULL, 0 }
+
+void *
+Z_PoolAlloc(zpool_t *pool);
+void
+Z_PoolFree(void *ptr);
+
+//
+// ARENAS
+// Bump allocated from a single tagged block, cache line
+// aligned, all released at once when the block is freed.
+//
+typedef struct zarena_s {
+	void *block; // NULL once freed
+	byte *base;
+	int size;
+	int used;
+} zarena_t;
+
+#define Z_ARENAALIGN 64
+#define Z_ARENASIZE(size) (((size) + Z_ARENAALIGN - 1) & ~(Z_ARENAALIGN - 1))
+
+void
+Z_ArenaInit(zarena_t *arena, int size, int tag);
+void *
+Z_ArenaAlloc(zarena_t *arena, int size);
+
+//
+// SCRATCH
+// Lock free bump allocator, the only allocation any
+// thread may do, the zone itself is main thread only.
+// framescratch is emptied at the start of every D_Display,
+// tasks give back their memory earlier with a mark.
+//
+typedef struct zscratch_s {
+	byte *base;
+	int size;
+	int used;
+} zscratch_t;
+
+extern zscratch_t framescratch;
+
+void
+Z_ScratchInit(zscratch_t *scratch, int size);
+void *
+Z_ScratchAlloc(zscratch_t *scratch, int size);
+int
+Z_ScratchMark(zscratch_t *scratch);
+void
+Z_ScratchRelease(zscratch_t *scratch, int mark);
 
 typedef struct memblock_s {
 	int size;    // including the header and possibly tiny fragments
@@ -63,6 +137,10 @@ typedef struct memblock_s {
 	int id;      // should be ZONEID
 	struct memblock_s *next;
 	struct memblock_s *prev;
+	// free list of its size class if free,
+	// purge order if purgable, else unused
+	struct memblock_s *lnext;
+	struct memblock_s *lprev;
 } memblock_t;
 
 //